@@ -0,0 +1,100 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_BENCH_COUNTERS_HPP
+#define NETU_BENCH_COUNTERS_HPP
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace netu
+{
+namespace bench
+{
+
+// Number of calls to the global operator new made so far, by all threads.
+// Counts every allocation, including the ones made by std::function and Asio,
+// so that all compared code paths are measured the same way.
+std::size_t
+allocation_count() noexcept;
+
+class allocation_probe
+{
+public:
+    explicit allocation_probe(benchmark::State& state) noexcept
+      : state_{state}
+      , start_{allocation_count()}
+    {
+    }
+
+    ~allocation_probe()
+    {
+        state_.counters["allocs/op"] =
+          benchmark::Counter(static_cast<double>(allocation_count() - start_),
+                             benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    benchmark::State& state_;
+    std::size_t start_;
+};
+
+class latency_recorder
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    explicit latency_recorder(benchmark::State& state)
+      : state_{state}
+    {
+        samples_.reserve(1u << 16u);
+    }
+
+    ~latency_recorder()
+    {
+        if (samples_.empty())
+        {
+            return;
+        }
+
+        state_.counters["p50_ns"] = percentile(50);
+        state_.counters["p99_ns"] = percentile(99);
+    }
+
+    template<typename Callable>
+    void measure(Callable&& f)
+    {
+        auto const start = clock_type::now();
+        f();
+        auto const d = clock_type::now() - start;
+        samples_.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    }
+
+private:
+    double percentile(std::size_t p)
+    {
+        auto const n = (samples_.size() - 1) * p / 100;
+        std::nth_element(
+          samples_.begin(), samples_.begin() + n, samples_.end());
+        return static_cast<double>(samples_[n]);
+    }
+
+    benchmark::State& state_;
+    std::vector<std::int64_t> samples_;
+};
+
+} // namespace bench
+} // namespace netu
+
+#endif // NETU_BENCH_COUNTERS_HPP
@@ -0,0 +1,76 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/adaptive_mutex.hpp>
+#include <netu/synchronized_value.hpp>
+
+#include <netu/bench/counters.hpp>
+
+#include <cstdint>
+#include <mutex>
+
+namespace netu
+{
+
+namespace
+{
+
+synchronized_value<std::uint64_t, std::mutex> std_sv{0u};
+synchronized_value<std::uint64_t, adaptive_mutex> adaptive_sv{0u};
+
+// The argument is the number of increments performed inside the critical
+// section, which controls how long the lock is held and therefore how likely
+// threads are to contend for it.
+template<typename SynchronizedValue>
+void
+apply_contended(benchmark::State& state, SynchronizedValue& sv)
+{
+    auto const work = static_cast<std::uint64_t>(state.range(0));
+    bench::latency_recorder latency{state};
+    for (auto _ : state)
+    {
+        latency.measure([&]() {
+            netu::apply(
+              [work](std::uint64_t& v) {
+                  for (std::uint64_t i = 0; i < work; ++i)
+                  {
+                      benchmark::DoNotOptimize(++v);
+                  }
+              },
+              sv);
+        });
+    }
+}
+
+void
+apply_std_mutex(benchmark::State& state)
+{
+    apply_contended(state, std_sv);
+}
+
+void
+apply_adaptive_mutex(benchmark::State& state)
+{
+    apply_contended(state, adaptive_sv);
+}
+
+} // namespace
+
+BENCHMARK(apply_std_mutex)
+  ->RangeMultiplier(8)
+  ->Range(1, 512)
+  ->ThreadRange(1, 8)
+  ->UseRealTime();
+BENCHMARK(apply_adaptive_mutex)
+  ->RangeMultiplier(8)
+  ->Range(1, 512)
+  ->ThreadRange(1, 8)
+  ->UseRealTime();
+
+} // namespace netu
@@ -0,0 +1,166 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/completion_handler.hpp>
+
+#include <netu/bench/counters.hpp>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+#include <array>
+#include <functional>
+
+namespace netu
+{
+
+namespace
+{
+
+struct small_handler
+{
+    int* counter_;
+
+    void operator()()
+    {
+        ++*counter_;
+    }
+};
+
+struct large_handler
+{
+    int* counter_;
+    std::array<char, 64> data_{};
+
+    void operator()()
+    {
+        *counter_ += data_[0] + 1;
+    }
+};
+
+template<typename Handler>
+Handler
+make_handler(int& counter)
+{
+    return Handler{&counter};
+}
+
+template<typename Handler>
+void
+completion_handler_construct_invoke(benchmark::State& state)
+{
+    int counter = 0;
+    bench::allocation_probe probe{state};
+    for (auto _ : state)
+    {
+        completion_handler<void()> ch{make_handler<Handler>(counter)};
+        benchmark::DoNotOptimize(ch);
+        ch.invoke();
+    }
+    benchmark::DoNotOptimize(counter);
+}
+
+template<typename Handler>
+void
+std_function_construct_invoke(benchmark::State& state)
+{
+    int counter = 0;
+    bench::allocation_probe probe{state};
+    for (auto _ : state)
+    {
+        std::function<void()> f{make_handler<Handler>(counter)};
+        benchmark::DoNotOptimize(f);
+        f();
+    }
+    benchmark::DoNotOptimize(counter);
+}
+
+template<typename Handler>
+void
+asio_post_invoke(benchmark::State& state)
+{
+    int counter = 0;
+    boost::asio::io_context ctx{1};
+    auto work = boost::asio::make_work_guard(ctx);
+    bench::allocation_probe probe{state};
+    for (auto _ : state)
+    {
+        boost::asio::post(ctx, make_handler<Handler>(counter));
+        ctx.poll_one();
+    }
+    benchmark::DoNotOptimize(counter);
+}
+
+// Same as asio_post_invoke, but the handler is erased before it's posted
+template<typename Handler>
+void
+completion_handler_post_invoke(benchmark::State& state)
+{
+    int counter = 0;
+    boost::asio::io_context ctx{1};
+    auto work = boost::asio::make_work_guard(ctx);
+    bench::allocation_probe probe{state};
+    for (auto _ : state)
+    {
+        boost::asio::post(
+          ctx, completion_handler<void()>{make_handler<Handler>(counter)});
+        ctx.poll_one();
+    }
+    benchmark::DoNotOptimize(counter);
+}
+
+template<typename Handler>
+void
+completion_handler_move(benchmark::State& state)
+{
+    int counter = 0;
+    completion_handler<void()> ch1{make_handler<Handler>(counter)};
+    completion_handler<void()> ch2;
+    bench::allocation_probe probe{state};
+    for (auto _ : state)
+    {
+        ch2 = std::move(ch1);
+        ch1 = std::move(ch2);
+        benchmark::DoNotOptimize(ch1);
+    }
+}
+
+template<typename Handler>
+void
+std_function_move(benchmark::State& state)
+{
+    int counter = 0;
+    std::function<void()> f1{make_handler<Handler>(counter)};
+    std::function<void()> f2;
+    bench::allocation_probe probe{state};
+    for (auto _ : state)
+    {
+        f2 = std::move(f1);
+        f1 = std::move(f2);
+        benchmark::DoNotOptimize(f1);
+    }
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(completion_handler_construct_invoke, small_handler);
+BENCHMARK_TEMPLATE(completion_handler_construct_invoke, large_handler);
+BENCHMARK_TEMPLATE(std_function_construct_invoke, small_handler);
+BENCHMARK_TEMPLATE(std_function_construct_invoke, large_handler);
+BENCHMARK_TEMPLATE(asio_post_invoke, small_handler);
+BENCHMARK_TEMPLATE(asio_post_invoke, large_handler);
+BENCHMARK_TEMPLATE(completion_handler_post_invoke, small_handler);
+BENCHMARK_TEMPLATE(completion_handler_post_invoke, large_handler);
+BENCHMARK_TEMPLATE(completion_handler_move, small_handler);
+BENCHMARK_TEMPLATE(completion_handler_move, large_handler);
+BENCHMARK_TEMPLATE(std_function_move, small_handler);
+BENCHMARK_TEMPLATE(std_function_move, large_handler);
+
+} // namespace netu
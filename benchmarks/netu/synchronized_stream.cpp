@@ -0,0 +1,178 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/synchronized_stream.hpp>
+
+#include <netu/bench/counters.hpp>
+
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <array>
+
+namespace netu
+{
+
+namespace
+{
+
+using socket_t = boost::asio::local::stream_protocol::socket;
+
+// Sends one byte from s1 to s2 and back.
+template<typename Stream>
+void
+round_trip(boost::asio::io_context& ctx, Stream& s1, Stream& s2)
+{
+    static char wb1 = 'a';
+    static char rb1 = '\0';
+    static char wb2 = 'b';
+    static char rb2 = '\0';
+
+    s2.async_read_some(
+      boost::asio::buffer(&rb2, 1),
+      [&s2](boost::system::error_code ec, std::size_t) {
+          if (ec)
+          {
+              return;
+          }
+          s2.async_write_some(boost::asio::buffer(&wb2, 1),
+                              [](boost::system::error_code, std::size_t) {});
+      });
+    s1.async_write_some(boost::asio::buffer(&wb1, 1),
+                        [](boost::system::error_code, std::size_t) {});
+    s1.async_read_some(boost::asio::buffer(&rb1, 1),
+                       [](boost::system::error_code, std::size_t) {});
+    ctx.run();
+    ctx.restart();
+}
+
+template<typename Stream>
+void
+stream_round_trip(benchmark::State& state)
+{
+    boost::asio::io_context ctx{1};
+    Stream s1{ctx};
+    Stream s2{ctx};
+    boost::asio::local::connect_pair(s1.lowest_layer(), s2.lowest_layer());
+
+    bench::allocation_probe probe{state};
+    bench::latency_recorder latency{state};
+    for (auto _ : state)
+    {
+        latency.measure([&]() { round_trip(ctx, s1, s2); });
+    }
+}
+
+// Reads data which is already available, with or without speculative I/O
+void
+read_available(benchmark::State& state)
+{
+    boost::asio::io_context ctx{1};
+    synchronized_stream<socket_t> s1{ctx};
+    synchronized_stream<socket_t> s2{ctx};
+    boost::asio::local::connect_pair(s1.lowest_layer(), s2.lowest_layer());
+    s2.set_speculative_io(state.range(0) != 0);
+
+    char wb = 'a';
+    char rb = '\0';
+
+    bench::allocation_probe probe{state};
+    bench::latency_recorder latency{state};
+    for (auto _ : state)
+    {
+        s1.next_layer().write_some(boost::asio::buffer(&wb, 1));
+        latency.measure([&]() {
+            s2.async_read_some(boost::asio::buffer(&rb, 1),
+                               [](boost::system::error_code, std::size_t) {});
+            ctx.run();
+            ctx.restart();
+        });
+    }
+}
+
+constexpr std::size_t burst_size = 64;
+constexpr std::size_t message_size = 16;
+
+// Writes burst_size messages one after another, one write per message
+template<typename Stream>
+class chained_writer
+{
+public:
+    chained_writer(Stream& s, char const* data)
+      : s_{s}
+      , data_{data}
+    {
+    }
+
+    void operator()(boost::system::error_code ec = {}, std::size_t = 0)
+    {
+        if (ec || i_ == burst_size)
+        {
+            return;
+        }
+        auto b = boost::asio::buffer(data_ + i_++ * message_size, message_size);
+        boost::asio::async_write(s_, b, std::move(*this));
+    }
+
+private:
+    Stream& s_;
+    char const* data_;
+    std::size_t i_ = 0;
+};
+
+void
+write_burst(benchmark::State& state)
+{
+    boost::asio::io_context ctx{1};
+    synchronized_stream<socket_t> s1{ctx};
+    synchronized_stream<socket_t> s2{ctx};
+    boost::asio::local::connect_pair(s1.lowest_layer(), s2.lowest_layer());
+
+    static std::array<char, burst_size * message_size> wb{};
+    static std::array<char, burst_size * message_size> rb{};
+    auto const queued = state.range(0) != 0;
+
+    bench::allocation_probe probe{state};
+    bench::latency_recorder latency{state};
+    for (auto _ : state)
+    {
+        latency.measure([&]() {
+            boost::asio::async_read(
+              s2,
+              boost::asio::buffer(rb),
+              [](boost::system::error_code, std::size_t) {});
+            if (queued)
+            {
+                for (std::size_t i = 0; i < burst_size; ++i)
+                {
+                    s1.async_write(
+                      boost::asio::buffer(&wb[i * message_size], message_size),
+                      [](boost::system::error_code, std::size_t) {});
+                }
+            }
+            else
+            {
+                chained_writer<synchronized_stream<socket_t>>{s1, wb.data()}();
+            }
+            ctx.run();
+            ctx.restart();
+        });
+    }
+}
+
+} // namespace
+
+BENCHMARK(write_burst)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(stream_round_trip, socket_t);
+BENCHMARK_TEMPLATE(stream_round_trip, synchronized_stream<socket_t>);
+BENCHMARK(read_available)->Arg(0)->Arg(1);
+
+} // namespace netu
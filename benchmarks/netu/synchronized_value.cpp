@@ -0,0 +1,187 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/combining_value.hpp>
+#include <netu/instrumented_lockable.hpp>
+#include <netu/rcu_value.hpp>
+#include <netu/seqlock.hpp>
+#include <netu/sharded_value.hpp>
+#include <netu/synchronized_value.hpp>
+
+#include <netu/bench/counters.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <tuple>
+
+namespace netu
+{
+
+namespace
+{
+
+synchronized_value<std::uint64_t> shared_sv1{0u};
+synchronized_value<std::uint64_t> shared_sv2{0u};
+synchronized_value<std::uint64_t, seqlock> shared_seq_sv{0u};
+rcu_value<std::uint64_t> shared_rcu{0u};
+sharded_value<std::uint64_t, 8> shared_sharded;
+combining_value<std::uint64_t> shared_combining{0u};
+synchronized_value<std::uint64_t, instrumented_lockable<std::mutex>>
+  shared_instrumented{std::piecewise_construct,
+                      std::forward_as_tuple(0u),
+                      std::forward_as_tuple("shared_instrumented")};
+
+std::mutex shared_mutex;
+std::uint64_t shared_counter = 0;
+
+void
+apply_single(benchmark::State& state)
+{
+    bench::latency_recorder latency{state};
+    for (auto _ : state)
+    {
+        latency.measure([]() {
+            netu::apply([](std::uint64_t& v) { ++v; }, shared_sv1);
+        });
+    }
+}
+
+void
+apply_instrumented(benchmark::State& state)
+{
+    bench::latency_recorder latency{state};
+    for (auto _ : state)
+    {
+        latency.measure([]() {
+            netu::apply([](std::uint64_t& v) { ++v; }, shared_instrumented);
+        });
+    }
+}
+
+void
+apply_sharded(benchmark::State& state)
+{
+    bench::latency_recorder latency{state};
+    for (auto _ : state)
+    {
+        latency.measure([]() {
+            netu::apply([](std::uint64_t& v) { ++v; }, shared_sharded);
+        });
+    }
+}
+
+void
+apply_combining(benchmark::State& state)
+{
+    bench::latency_recorder latency{state};
+    for (auto _ : state)
+    {
+        latency.measure([]() {
+            netu::apply([](std::uint64_t& v) { ++v; }, shared_combining);
+        });
+    }
+}
+
+void
+apply_multi(benchmark::State& state)
+{
+    bench::latency_recorder latency{state};
+    for (auto _ : state)
+    {
+        latency.measure([]() {
+            netu::apply(
+              [](std::uint64_t& v1, std::uint64_t& v2) {
+                  ++v1;
+                  --v2;
+              },
+              shared_sv1,
+              shared_sv2);
+        });
+    }
+}
+
+void
+apply_multi_ordered(benchmark::State& state)
+{
+    bench::latency_recorder latency{state};
+    for (auto _ : state)
+    {
+        latency.measure([]() {
+            netu::apply(
+              ordered_lock_policy{},
+              [](std::uint64_t& v1, std::uint64_t& v2) {
+                  ++v1;
+                  --v2;
+              },
+              shared_sv1,
+              shared_sv2);
+        });
+    }
+}
+
+void
+apply_read_mutex(benchmark::State& state)
+{
+    auto const& sv = shared_sv1;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(
+          netu::apply([](std::uint64_t const& v) { return v; }, sv));
+    }
+}
+
+void
+apply_read_seqlock(benchmark::State& state)
+{
+    auto const& sv = shared_seq_sv;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(
+          netu::apply([](std::uint64_t const& v) { return v; }, sv));
+    }
+}
+
+void
+apply_read_rcu(benchmark::State& state)
+{
+    auto const& rv = shared_rcu;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(
+          netu::apply([](std::uint64_t const& v) { return v; }, rv));
+    }
+}
+
+void
+mutex_lock_guard(benchmark::State& state)
+{
+    bench::latency_recorder latency{state};
+    for (auto _ : state)
+    {
+        latency.measure([]() {
+            std::lock_guard<std::mutex> guard{shared_mutex};
+            ++shared_counter;
+        });
+    }
+}
+
+} // namespace
+
+BENCHMARK(apply_single)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(apply_instrumented)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(apply_sharded)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(apply_combining)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(apply_multi)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(apply_multi_ordered)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(apply_read_mutex)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(apply_read_seqlock)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(apply_read_rcu)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(mutex_lock_guard)->ThreadRange(1, 8)->UseRealTime();
+
+} // namespace netu
@@ -0,0 +1,60 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_ADAPTIVE_MUTEX_HPP
+#define NETU_ADAPTIVE_MUTEX_HPP
+
+#include <atomic>
+
+namespace netu
+{
+
+// Lockable for short critical sections, like the ones of apply(). A
+// contended lock() spins with exponential backoff for a bounded number of
+// iterations, hoping that the owner releases the lock soon, before it parks
+// the thread on a futex.
+class adaptive_mutex
+{
+public:
+    // Number of backoff rounds before parking, each round pauses twice as
+    // long as the previous one, up to max_backoff pauses.
+    static constexpr int spin_rounds = 16;
+    static constexpr int max_backoff = 64;
+
+    adaptive_mutex() = default;
+
+    adaptive_mutex(adaptive_mutex const&) = delete;
+    adaptive_mutex& operator=(adaptive_mutex const&) = delete;
+
+    void lock() noexcept;
+
+    bool try_lock() noexcept;
+
+    void unlock() noexcept;
+
+private:
+    enum : int
+    {
+        unlocked = 0,
+        locked = 1,
+        contended = 2 // Locked and there may be parked threads
+    };
+
+    bool spin() noexcept;
+
+    void park() noexcept;
+
+    std::atomic<int> state_{unlocked};
+};
+
+} // namespace netu
+
+#include <netu/impl/adaptive_mutex.hpp>
+
+#endif // NETU_ADAPTIVE_MUTEX_HPP
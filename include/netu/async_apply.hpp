@@ -0,0 +1,83 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_ASYNC_APPLY_HPP
+#define NETU_ASYNC_APPLY_HPP
+
+#include <netu/async_mutex.hpp>
+#include <netu/detail/async_utils.hpp>
+#include <netu/synchronized_value.hpp>
+
+#include <boost/asio/system_executor.hpp>
+
+#include <type_traits>
+
+namespace netu
+{
+
+namespace detail
+{
+
+template<typename R>
+struct apply_signature
+{
+    using type = void(typename std::decay<R>::type);
+};
+
+template<>
+struct apply_signature<void>
+{
+    using type = void();
+};
+
+template<typename Callable, typename T>
+using apply_signature_t = typename apply_signature<decltype(
+  std::declval<typename std::decay<Callable>::type&>()(
+    std::declval<T&>()))>::type;
+
+} // namespace detail
+
+// Asynchronously acquires the lock of sv, invokes f with the value and
+// completes with the result of f. The lock is released before the completion
+// handler is invoked. Both f and the completion handler are invoked on the
+// handler's associated executor, which defaults to the executor of ctx.
+//
+// Exceptions thrown by f are propagated out of the executor's run function,
+// after the lock is released.
+template<typename ExecutionContext,
+         typename T,
+         typename Layout,
+         typename Callable,
+         typename CompletionToken>
+auto
+async_apply(ExecutionContext& ctx,
+            synchronized_value<T, async_mutex, Layout>& sv,
+            Callable&& f,
+            CompletionToken&& tok)
+  -> detail::completion_result_t<CompletionToken,
+                                 detail::apply_signature_t<Callable, T>>;
+
+// Same as above, but the completion handler's associated executor defaults
+// to the system executor.
+template<typename T,
+         typename Layout,
+         typename Callable,
+         typename CompletionToken>
+auto
+async_apply(synchronized_value<T, async_mutex, Layout>& sv,
+            Callable&& f,
+            CompletionToken&& tok)
+  -> detail::completion_result_t<CompletionToken,
+                                 detail::apply_signature_t<Callable, T>>;
+
+} // namespace netu
+
+#include <netu/impl/async_apply.hpp>
+
+#endif // NETU_ASYNC_APPLY_HPP
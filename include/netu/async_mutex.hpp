@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_ASYNC_MUTEX_HPP
+#define NETU_ASYNC_MUTEX_HPP
+
+#include <netu/completion_handler.hpp>
+#include <netu/detail/async_utils.hpp>
+
+#include <boost/asio/executor.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace netu
+{
+
+// Lockable which can also be acquired asynchronously. Instead of blocking
+// a thread, async_lock() queues the completion handler, which is invoked on
+// its associated executor once the lock is handed over to it. The handler
+// owns the lock and must unlock() it.
+//
+// Queued handlers always take priority over threads blocked in lock(), which
+// only acquire the mutex when it's unlocked with no handlers queued. Under
+// constant asynchronous contention blocking lockers can starve.
+//
+// If unlock() fails to post a queued handler, the handler is destroyed, the
+// lock passes on as if it had been unlocked again and the exception is
+// rethrown.
+//
+// Queued handlers are destroyed without being invoked if the mutex is
+// destroyed.
+class async_mutex
+{
+public:
+    async_mutex() = default;
+
+    async_mutex(async_mutex const&) = delete;
+    async_mutex& operator=(async_mutex const&) = delete;
+
+    ~async_mutex() = default;
+
+    void lock();
+
+    bool try_lock();
+
+    void unlock();
+
+    template<typename CompletionToken>
+    auto async_lock(CompletionToken&& tok)
+      -> detail::completion_result_t<CompletionToken, void()>;
+
+private:
+    using handler_type = completion_handler<void()>;
+    using work_guard_type = boost::asio::executor_work_guard<
+      boost::asio::associated_executor_t<handler_type>>;
+
+    struct waiter
+    {
+        explicit waiter(handler_type&& h)
+          : work_{boost::asio::get_associated_executor(h)}
+          , handler_{std::move(h)}
+        {
+        }
+
+        // Keeps the executor of the handler busy while it's queued
+        work_guard_type work_;
+        handler_type handler_;
+    };
+
+    // Returns true if the lock has been acquired, otherwise queues h
+    bool lock_or_enqueue(handler_type& h);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<waiter> waiters_;
+    std::size_t blocked_ = 0;
+    bool locked_ = false;
+};
+
+} // namespace netu
+
+#include <netu/impl/async_mutex.hpp>
+
+#endif // NETU_ASYNC_MUTEX_HPP
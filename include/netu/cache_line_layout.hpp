@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_CACHE_LINE_LAYOUT_HPP
+#define NETU_CACHE_LINE_LAYOUT_HPP
+
+#include <cstddef>
+
+// std::hardware_destructive_interference_size isn't used, because its value
+// depends on tuning flags, which would make the layout of types defined in
+// headers differ between translation units.
+#ifndef NETU_CACHE_LINE_SIZE
+#define NETU_CACHE_LINE_SIZE 64
+#endif
+
+namespace netu
+{
+
+constexpr std::size_t cache_line_size = NETU_CACHE_LINE_SIZE;
+
+// Layout policies of synchronized_value. Over-aligned objects are only
+// guaranteed to be correctly aligned on the heap since C++17.
+
+// Value and mutex are laid out like plain members, next to any neighbouring
+// data.
+struct default_layout
+{
+    template<typename T>
+    static constexpr std::size_t value_alignment()
+    {
+        return alignof(T);
+    }
+
+    template<typename Lockable>
+    static constexpr std::size_t mutex_alignment()
+    {
+        return alignof(Lockable);
+    }
+};
+
+// Value and mutex share cache lines which don't hold any other data. Best for
+// small values, which are always accessed under the lock.
+struct colocated_layout
+{
+    template<typename T>
+    static constexpr std::size_t value_alignment()
+    {
+        return alignof(T) > cache_line_size ? alignof(T) : cache_line_size;
+    }
+
+    template<typename Lockable>
+    static constexpr std::size_t mutex_alignment()
+    {
+        return alignof(Lockable);
+    }
+};
+
+// Value and mutex start on separate cache lines, so that threads waiting for
+// the lock don't interfere with the owner accessing the value.
+struct padded_layout
+{
+    template<typename T>
+    static constexpr std::size_t value_alignment()
+    {
+        return alignof(T) > cache_line_size ? alignof(T) : cache_line_size;
+    }
+
+    template<typename Lockable>
+    static constexpr std::size_t mutex_alignment()
+    {
+        return alignof(Lockable) > cache_line_size ? alignof(Lockable)
+                                                   : cache_line_size;
+    }
+};
+
+} // namespace netu
+
+#endif // NETU_CACHE_LINE_LAYOUT_HPP
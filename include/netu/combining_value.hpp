@@ -0,0 +1,103 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_COMBINING_VALUE_HPP
+#define NETU_COMBINING_VALUE_HPP
+
+#include <netu/cache_line_layout.hpp>
+#include <netu/completion_handler_ref.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+namespace netu
+{
+
+// Value for heavily contended updates, which uses flat combining.
+//
+// Mutating apply() executes the callable directly if the lock is free.
+// Otherwise, it publishes the callable in a slot assigned to the calling
+// thread. The thread which acquires the lock executes all published
+// callables in one go, while the value is hot in its cache, so the value and
+// the lock don't have to bounce between the cores of every caller. Results
+// and exceptions are returned to the threads which published the callables.
+//
+// Const apply() simply locks the value.
+template<typename T, typename Lockable = std::mutex, std::size_t SlotCount = 64>
+class combining_value
+{
+    static_assert(SlotCount > 0, "At least one slot is required");
+
+public:
+    using value_type = T;
+    using mutex_type = Lockable;
+
+    static constexpr std::size_t slot_count = SlotCount;
+
+    combining_value() = default;
+
+    template<typename Arg1, typename... Args>
+    explicit combining_value(Arg1&& arg1, Args&&... args);
+
+    combining_value(combining_value&&) = delete;
+    combining_value(combining_value const&) = delete;
+
+    combining_value& operator=(combining_value&&) = delete;
+    combining_value& operator=(combining_value const&) = delete;
+
+    ~combining_value() = default;
+
+    template<typename Callable, typename U, typename L, std::size_t S>
+    friend auto apply(Callable&& f, combining_value<U, L, S>& cv)
+      -> decltype(std::forward<Callable>(f)(std::declval<U&>()));
+
+    template<typename Callable, typename U, typename L, std::size_t S>
+    friend auto apply(Callable&& f, combining_value<U, L, S> const& cv)
+      -> decltype(std::forward<Callable>(f)(std::declval<U const&>()));
+
+private:
+    struct request
+    {
+        explicit request(completion_handler_ref<void(T&)> op) noexcept
+          : op_{op}
+        {
+        }
+
+        completion_handler_ref<void(T&)> op_;
+        std::exception_ptr error_;
+        std::atomic<bool> done_{false};
+    };
+
+    struct slot
+    {
+        alignas(cache_line_size) std::atomic<request*> request_{nullptr};
+    };
+
+    std::atomic<request*>& local_slot() noexcept;
+
+    // Waits until another thread executes r or executes it itself
+    void wait_or_combine(request& r);
+
+    // Executes all published requests, must be called with the lock held
+    void combine() noexcept;
+
+    alignas(cache_line_size) T value_;
+    mutable Lockable mutex_;
+    std::array<slot, SlotCount> slots_;
+};
+
+} // namespace netu
+
+#include <netu/impl/combining_value.hpp>
+
+#endif // NETU_COMBINING_VALUE_HPP
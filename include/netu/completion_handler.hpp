@@ -16,13 +16,20 @@
 namespace netu
 {
 
-template<typename Signature>
+template<typename Signature,
+         std::size_t Capacity = detail::default_handler_capacity,
+         std::size_t Alignment = detail::default_handler_alignment>
 class completion_handler;
 
-template<typename R, typename... Ts>
-class completion_handler<R(Ts...)>
+template<typename R,
+         typename... Ts,
+         std::size_t Capacity,
+         std::size_t Alignment>
+class completion_handler<R(Ts...), Capacity, Alignment>
 {
 public:
+    using allocator_type = detail::allocators::erased_allocator<void>;
+
     completion_handler() = default;
 
     completion_handler(std::nullptr_t) noexcept;
@@ -51,33 +58,80 @@ public:
     template<typename... Args>
     R invoke(Args&&... args);
 
+    template<typename... Args>
+    R operator()(Args&&... args);
+
     explicit operator bool() const noexcept;
 
-    template<typename U, typename... Vs>
-    friend bool operator==(completion_handler<U(Vs...)> const& lhs,
+    // Returns the associated executor of the stored handler, or ex if it has
+    // none. Used by the associated_executor specialization.
+    template<typename Executor>
+    detail::erased_executor<Executor> get_executor(Executor const& ex) const;
+
+    // Handlers without an associated allocator allocate from the thread cache
+    allocator_type get_allocator() const noexcept;
+
+    template<typename U, typename... Vs, std::size_t C, std::size_t A>
+    friend bool operator==(completion_handler<U(Vs...), C, A> const& lhs,
                            std::nullptr_t) noexcept;
 
-    template<typename U, typename... Vs>
-    friend bool operator==(std::nullptr_t lhs,
-                           completion_handler<U(Vs...)> const& rhs) noexcept;
+    template<typename U, typename... Vs, std::size_t C, std::size_t A>
+    friend bool
+    operator==(std::nullptr_t lhs,
+               completion_handler<U(Vs...), C, A> const& rhs) noexcept;
 
-    template<typename U, typename... Vs>
-    friend bool operator!=(completion_handler<U(Vs...)> const& lhs,
+    template<typename U, typename... Vs, std::size_t C, std::size_t A>
+    friend bool operator!=(completion_handler<U(Vs...), C, A> const& lhs,
                            std::nullptr_t rhs) noexcept;
 
-    template<typename U, typename... Vs>
-    friend bool operator!=(std::nullptr_t lhs,
-                           completion_handler<U(Vs...)> const& rhs) noexcept;
+    template<typename U, typename... Vs, std::size_t C, std::size_t A>
+    friend bool
+    operator!=(std::nullptr_t lhs,
+               completion_handler<U(Vs...), C, A> const& rhs) noexcept;
+
+protected:
+    template<typename Handler>
+    completion_handler(detail::inplace_tag, Handler&& handler);
 
 private:
-    static detail::vtable<R(Ts...)> const* default_vtable();
+    using storage_type = detail::basic_raw_handler_storage<Capacity, Alignment>;
+    using vtable_type = detail::vtable<R(Ts...), storage_type>;
+
+    static vtable_type const* default_vtable();
 
-    detail::raw_handler_storage storage_;
-    detail::vtable<R(Ts...)> const* vtable_ = default_vtable();
+    storage_type storage_;
+    vtable_type const* vtable_ = default_vtable();
 };
 
 } // namespace netu
 
+namespace boost
+{
+namespace asio
+{
+
+template<typename R,
+         typename... Ts,
+         std::size_t Capacity,
+         std::size_t Alignment,
+         typename Executor>
+struct associated_executor<
+  netu::completion_handler<R(Ts...), Capacity, Alignment>,
+  Executor>
+{
+    using type = netu::detail::erased_executor<Executor>;
+
+    static type get(
+      netu::completion_handler<R(Ts...), Capacity, Alignment> const& h,
+      Executor const& ex = Executor())
+    {
+        return h.get_executor(ex);
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
 #include <netu/impl/completion_handler.hpp>
 
 #endif // NETU_COMPLETION_HANDLER_HPP
@@ -0,0 +1,56 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_COMPLETION_HANDLER_REF_HPP
+#define NETU_COMPLETION_HANDLER_REF_HPP
+
+#include <netu/detail/handler_erasure.hpp>
+#include <netu/detail/type_traits.hpp>
+
+namespace netu
+{
+
+// Non-owning, trivially copyable reference to a callable. The referenced
+// callable must outlive all invocations, so this is only suitable for
+// synchronous callbacks.
+template<typename Signature>
+class completion_handler_ref;
+
+template<typename R, typename... Ts>
+class completion_handler_ref<R(Ts...)>
+{
+public:
+    template<typename U, typename... Vs>
+    completion_handler_ref(U (*f)(Vs...)) noexcept;
+
+    template<
+      typename Handler,
+      class = detail::disable_conversion_t<Handler, completion_handler_ref>>
+    completion_handler_ref(Handler&& handler) noexcept;
+
+    completion_handler_ref(completion_handler_ref const&) = default;
+
+    completion_handler_ref& operator=(completion_handler_ref const&) = default;
+
+    template<typename... Args>
+    R operator()(Args&&... args) const;
+
+private:
+    using storage_type = detail::handler_ref_storage;
+    using invoke_t = R (*)(storage_type&, Ts...);
+
+    storage_type storage_;
+    invoke_t invoke_;
+};
+
+} // namespace netu
+
+#include <netu/impl/completion_handler_ref.hpp>
+
+#endif // NETU_COMPLETION_HANDLER_REF_HPP
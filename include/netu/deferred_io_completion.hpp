@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_DEFERRED_IO_COMPLETION_HPP
+#define NETU_DEFERRED_IO_COMPLETION_HPP
+
+#include <netu/completion_handler.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <vector>
+
+namespace netu
+{
+
+// An I/O completion handler together with the result it is going to be
+// invoked with.
+class deferred_io_completion
+{
+public:
+    using handler_type =
+      completion_handler<void(boost::system::error_code, std::size_t)>;
+
+    deferred_io_completion() = default;
+
+    template<
+      typename Handler,
+      class = detail::disable_conversion_t<Handler, deferred_io_completion>>
+    deferred_io_completion(Handler&& handler,
+                           boost::system::error_code ec,
+                           std::size_t bytes_transferred);
+
+    deferred_io_completion(deferred_io_completion&&) = default;
+    deferred_io_completion(deferred_io_completion const&) = delete;
+
+    deferred_io_completion& operator=(deferred_io_completion&&) = default;
+    deferred_io_completion& operator=(deferred_io_completion const&) = delete;
+
+    ~deferred_io_completion() = default;
+
+    void operator()();
+
+    explicit operator bool() const noexcept;
+
+    boost::system::error_code const& error() const noexcept;
+
+    std::size_t bytes_transferred() const noexcept;
+
+    template<typename Executor>
+    detail::erased_executor<Executor> get_executor(Executor const& ex) const;
+
+private:
+    handler_type handler_;
+    boost::system::error_code ec_;
+    std::size_t bytes_transferred_ = 0;
+};
+
+// Collects deferred completions, so that they can be invoked back-to-back from
+// contiguous storage. The storage is reused between batches.
+class deferred_io_batch
+{
+public:
+    deferred_io_batch() = default;
+
+    explicit deferred_io_batch(std::size_t capacity);
+
+    template<typename Handler>
+    void push(Handler&& handler,
+              boost::system::error_code ec,
+              std::size_t bytes_transferred);
+
+    void push(deferred_io_completion&& completion);
+
+    // Invokes all completions pushed so far, in order. Completions pushed by
+    // the invoked handlers are deferred until the next call. Returns the
+    // number of invoked completions.
+    std::size_t invoke();
+
+    std::size_t size() const noexcept;
+
+    bool empty() const noexcept;
+
+private:
+    std::vector<deferred_io_completion> pending_;
+    std::vector<deferred_io_completion> running_;
+};
+
+} // namespace netu
+
+namespace boost
+{
+namespace asio
+{
+
+template<typename Executor>
+struct associated_executor<netu::deferred_io_completion, Executor>
+{
+    using type = netu::detail::erased_executor<Executor>;
+
+    static type get(netu::deferred_io_completion const& c,
+                    Executor const& ex = Executor())
+    {
+        return c.get_executor(ex);
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#include <netu/impl/deferred_io_completion.hpp>
+
+#endif // NETU_DEFERRED_IO_COMPLETION_HPP
@@ -21,6 +21,13 @@ namespace netu
 namespace detail
 {
 
+template<typename CompletionToken, typename Signature>
+using completion_t = boost::asio::async_completion<CompletionToken, Signature>;
+
+template<typename CompletionToken, typename Signature>
+using completion_result_t =
+  BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, Signature);
+
 template<typename CompletionToken>
 using io_completion_t =
   boost::asio::async_completion<CompletionToken,
@@ -0,0 +1,178 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_DETAIL_ERASED_ALLOCATOR_HPP
+#define NETU_DETAIL_ERASED_ALLOCATOR_HPP
+
+#include <netu/detail/recycling_allocator.hpp>
+
+#include <boost/core/pointer_traits.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace netu
+{
+namespace detail
+{
+namespace allocators
+{
+
+struct erased_allocator_ops
+{
+    // Most handler allocators are either empty or hold a pointer to an arena
+    using state_type =
+      std::aligned_storage<2 * sizeof(void*), alignof(void*)>::type;
+
+    void* (*allocate)(state_type const&, std::size_t /*bytes*/);
+    void (*deallocate)(state_type const&,
+                       void*,
+                       std::size_t /*bytes*/) /*noexcept*/;
+};
+
+template<typename Allocator>
+using can_erase_allocator = std::integral_constant<
+  bool,
+  std::is_trivially_copyable<Allocator>::value &&
+    sizeof(Allocator) <= sizeof(erased_allocator_ops::state_type) &&
+    alignof(Allocator) <= alignof(erased_allocator_ops::state_type) &&
+    std::is_same<typename std::allocator_traits<Allocator>::pointer,
+                 typename std::allocator_traits<Allocator>::value_type*>::
+      value>;
+
+template<typename Allocator>
+struct erased_allocator_ops_generator
+{
+    using state_type = erased_allocator_ops::state_type;
+    using block_type =
+      typename std::aligned_storage<alignof(std::max_align_t),
+                                    alignof(std::max_align_t)>::type;
+    using alloc_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<block_type>;
+    using traits_type = std::allocator_traits<alloc_type>;
+
+    static std::size_t blocks(std::size_t bytes) noexcept
+    {
+        return (bytes + sizeof(block_type) - 1) / sizeof(block_type);
+    }
+
+    static void* allocate(state_type const& s, std::size_t bytes)
+    {
+        alloc_type alloc{*reinterpret_cast<Allocator const*>(&s)};
+        return boost::to_address(traits_type::allocate(alloc, blocks(bytes)));
+    }
+
+    static void deallocate(state_type const& s,
+                           void* p,
+                           std::size_t bytes) noexcept
+    {
+        alloc_type alloc{*reinterpret_cast<Allocator const*>(&s)};
+        traits_type::deallocate(
+          alloc, static_cast<block_type*>(p), blocks(bytes));
+    }
+
+    static constexpr erased_allocator_ops value{allocate, deallocate};
+};
+
+template<typename Allocator>
+constexpr erased_allocator_ops erased_allocator_ops_generator<Allocator>::value;
+
+// Allocator which forwards to a type-erased copy of another allocator. Only
+// small, trivially copyable allocators with raw pointers can be erased.
+template<typename T>
+class erased_allocator
+{
+public:
+    using value_type = T;
+
+    template<typename Allocator>
+    explicit erased_allocator(Allocator const& alloc) noexcept
+      : ops_{&erased_allocator_ops_generator<Allocator>::value}
+    {
+        static_assert(can_erase_allocator<Allocator>::value,
+                      "Allocator cannot be type-erased");
+        ::new (static_cast<void*>(&state_)) Allocator(alloc);
+    }
+
+    template<typename U>
+    erased_allocator(erased_allocator<U> const& other) noexcept
+      : state_(other.state_)
+      , ops_{other.ops_}
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t),
+                      "Over-aligned types are not supported.");
+        return static_cast<T*>(ops_->allocate(state_, n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        ops_->deallocate(state_, p, n * sizeof(T));
+    }
+
+    template<typename U>
+    friend bool operator==(erased_allocator const& lhs,
+                           erased_allocator<U> const& rhs) noexcept
+    {
+        return lhs.ops_ == rhs.ops_ &&
+               std::memcmp(&lhs.state_, &rhs.state_, sizeof(lhs.state_)) == 0;
+    }
+
+    template<typename U>
+    friend bool operator!=(erased_allocator const& lhs,
+                           erased_allocator<U> const& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    template<typename U>
+    friend class erased_allocator;
+
+    erased_allocator_ops::state_type state_{};
+    erased_allocator_ops const* ops_;
+};
+
+template<typename Allocator>
+erased_allocator<void>
+erase_allocator(Allocator const& alloc) noexcept
+{
+    static_assert(can_erase_allocator<Allocator>::value,
+                  "Allocator cannot be type-erased");
+    return erased_allocator<void>{alloc};
+}
+
+// Handlers without a custom allocator allocate from the thread_cache, like
+// handlers which aren't erased.
+template<typename T>
+erased_allocator<void>
+erase_allocator(std::allocator<T> const&) noexcept
+{
+    return erased_allocator<void>{recycling_allocator<void>{}};
+}
+
+// The allocator of a nested erased handler is already erased
+template<typename T>
+erased_allocator<void>
+erase_allocator(erased_allocator<T> const& alloc) noexcept
+{
+    return erased_allocator<void>{alloc};
+}
+
+} // namespace allocators
+} // namespace detail
+} // namespace netu
+
+#endif // NETU_DETAIL_ERASED_ALLOCATOR_HPP
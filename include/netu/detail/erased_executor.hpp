@@ -0,0 +1,149 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_DETAIL_ERASED_EXECUTOR_HPP
+#define NETU_DETAIL_ERASED_EXECUTOR_HPP
+
+#include <boost/asio/execution_context.hpp>
+#include <boost/asio/executor.hpp>
+
+#include <utility>
+
+namespace netu
+{
+namespace detail
+{
+
+// Associated executor of a type-erased handler. Only handlers which have an
+// associated executor of their own carry it in a polymorphic executor. All
+// other handlers use the fallback executor of the associated_executor query,
+// which is stored as is, so that it can be copied and dispatched to without
+// allocating.
+template<typename Executor>
+class erased_executor
+{
+public:
+    erased_executor(Executor const& fallback,
+                    boost::asio::executor associated) noexcept
+      : fallback_{fallback}
+      , associated_{std::move(associated)}
+    {
+    }
+
+    boost::asio::execution_context& context() const noexcept
+    {
+        if (associated_)
+        {
+            return associated_.context();
+        }
+        return fallback_.context();
+    }
+
+    void on_work_started() const noexcept
+    {
+        if (associated_)
+        {
+            associated_.on_work_started();
+            return;
+        }
+        fallback_.on_work_started();
+    }
+
+    void on_work_finished() const noexcept
+    {
+        if (associated_)
+        {
+            associated_.on_work_finished();
+            return;
+        }
+        fallback_.on_work_finished();
+    }
+
+    template<typename Function, typename Allocator>
+    void dispatch(Function&& f, Allocator const& a) const
+    {
+        if (associated_)
+        {
+            associated_.dispatch(std::forward<Function>(f), a);
+            return;
+        }
+        fallback_.dispatch(std::forward<Function>(f), a);
+    }
+
+    template<typename Function, typename Allocator>
+    void post(Function&& f, Allocator const& a) const
+    {
+        if (associated_)
+        {
+            associated_.post(std::forward<Function>(f), a);
+            return;
+        }
+        fallback_.post(std::forward<Function>(f), a);
+    }
+
+    template<typename Function, typename Allocator>
+    void defer(Function&& f, Allocator const& a) const
+    {
+        if (associated_)
+        {
+            associated_.defer(std::forward<Function>(f), a);
+            return;
+        }
+        fallback_.defer(std::forward<Function>(f), a);
+    }
+
+    // Returns the executor associated with the erased handler, or an empty
+    // executor if it has none.
+    boost::asio::executor const& associated() const noexcept
+    {
+        return associated_;
+    }
+
+    friend bool operator==(erased_executor const& lhs,
+                           erased_executor const& rhs) noexcept
+    {
+        if (lhs.associated_ || rhs.associated_)
+        {
+            return lhs.associated_ == rhs.associated_;
+        }
+        return lhs.fallback_ == rhs.fallback_;
+    }
+
+    friend bool operator!=(erased_executor const& lhs,
+                           erased_executor const& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    Executor fallback_;
+    boost::asio::executor associated_;
+};
+
+// Converts the associated executor of a handler to a polymorphic executor.
+// The executor of a nested erased handler is unwrapped, so that a missing
+// association doesn't turn into the fallback of the inner query.
+template<typename Executor>
+boost::asio::executor
+make_polymorphic_executor(Executor const& ex)
+{
+    return boost::asio::executor{ex};
+}
+
+template<typename Executor>
+boost::asio::executor
+make_polymorphic_executor(erased_executor<Executor> const& ex) noexcept
+{
+    return ex.associated();
+}
+
+} // namespace detail
+} // namespace netu
+
+#endif // NETU_DETAIL_ERASED_EXECUTOR_HPP
@@ -0,0 +1,86 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_DETAIL_FUTEX_HPP
+#define NETU_DETAIL_FUTEX_HPP
+
+#include <atomic>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace netu
+{
+namespace detail
+{
+
+static_assert(sizeof(std::atomic<int>) == sizeof(int),
+              "Futexes require std::atomic<int> to have the layout of int");
+
+// Hints the CPU that the calling thread is busy-waiting
+inline void
+cpu_relax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Blocks the calling thread while word == expected. May return spuriously.
+inline void
+futex_wait(std::atomic<int>& word, int expected) noexcept
+{
+#if defined(__linux__)
+    ::syscall(SYS_futex,
+              reinterpret_cast<int*>(&word),
+              FUTEX_WAIT_PRIVATE,
+              expected,
+              nullptr,
+              nullptr,
+              0);
+#else
+    // There's no portable way of parking a thread on an address before C++20
+    if (word.load(std::memory_order_relaxed) == expected)
+    {
+        std::this_thread::yield();
+    }
+#endif
+}
+
+// Wakes up at most one thread blocked in futex_wait on word
+inline void
+futex_wake_one(std::atomic<int>& word) noexcept
+{
+#if defined(__linux__)
+    ::syscall(SYS_futex,
+              reinterpret_cast<int*>(&word),
+              FUTEX_WAKE_PRIVATE,
+              1,
+              nullptr,
+              nullptr,
+              0);
+#else
+    (void)word;
+#endif
+}
+
+} // namespace detail
+} // namespace netu
+
+#endif // NETU_DETAIL_FUTEX_HPP
@@ -11,94 +11,229 @@
 #define NETU_DETAIL_HANDLER_ERASURE_HPP
 
 #include <netu/detail/allocators.hpp>
+#include <netu/detail/erased_allocator.hpp>
+#include <netu/detail/erased_executor.hpp>
+#include <netu/detail/recycling_allocator.hpp>
 
 #include <boost/align/aligned_allocator_adaptor.hpp>
 #include <boost/asio/associated_allocator.hpp>
 #include <boost/asio/associated_executor.hpp>
+#include <boost/asio/executor.hpp>
 
 #include <boost/assert.hpp>
 
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
 namespace netu
 {
 
 namespace detail
 {
 
-template<typename Handler, typename Signature>
-struct vtable_generator;
-
-template<typename Signature>
-struct default_vtable_generator;
+// users of ASIO love to shove shared_ptr's into their CompletionHandlers,
+// so should take sizeof shared_ptr as the default max of SBO
+constexpr std::size_t default_handler_capacity = sizeof(std::shared_ptr<void>);
+constexpr std::size_t default_handler_alignment =
+  alignof(std::shared_ptr<void>);
 
-template<typename Signature>
-struct vtable;
+template<std::size_t Capacity, std::size_t Alignment>
+union basic_raw_handler_storage {
+    static_assert(Alignment != 0 && (Alignment & (Alignment - 1)) == 0,
+                  "Alignment must be a power of 2");
 
-union raw_handler_storage {
     using func_ptr_t = void (*)();
-    // users of ASIO love to shove shared_ptr's into their CompletionHandlers,
-    // so should take sizeof shared_ptr as the max of SBO
-    using sbo_storage_type = std::aligned_union<1, std::shared_ptr<void>>::type;
+    using sbo_storage_type =
+      typename std::aligned_storage<Capacity, Alignment>::type;
 
-    raw_handler_storage() = default;
+    basic_raw_handler_storage() = default;
 
-    raw_handler_storage(raw_handler_storage const&) = delete;
-    raw_handler_storage(raw_handler_storage&&) = delete;
+    basic_raw_handler_storage(basic_raw_handler_storage const&) = delete;
+    basic_raw_handler_storage(basic_raw_handler_storage&&) = delete;
 
-    raw_handler_storage& operator=(raw_handler_storage const&) = delete;
-    raw_handler_storage& operator=(raw_handler_storage&&) = delete;
+    basic_raw_handler_storage& operator=(basic_raw_handler_storage const&) =
+      delete;
+    basic_raw_handler_storage& operator=(basic_raw_handler_storage&&) = delete;
 
     void* void_ptr;
     func_ptr_t func_ptr; // never call this without casting to original type
     sbo_storage_type buffer;
 };
 
-template<typename R, typename... Ts>
-struct vtable<R(Ts...)>
+using raw_handler_storage =
+  basic_raw_handler_storage<default_handler_capacity,
+                            default_handler_alignment>;
+
+// Storage of non-owning handler references. Unlike the owning storage, it is
+// trivially copyable.
+union handler_ref_storage {
+    using func_ptr_t = void (*)();
+
+    void* void_ptr;
+    func_ptr_t func_ptr; // never call this without casting to original type
+};
+
+template<typename Handler,
+         typename Signature,
+         typename Storage = raw_handler_storage>
+struct vtable_generator;
+
+template<typename Signature, typename Storage = raw_handler_storage>
+struct default_vtable_generator;
+
+template<typename Signature, typename Storage = raw_handler_storage>
+struct vtable;
+
+enum class manage_op
+{
+    move,
+    destroy
+};
+
+// Handlers which can be moved with a memcpy and need no destructor call. The
+// vtables of such handlers have no manage function, which lets
+// completion_handler move them without an indirect call.
+template<typename T>
+using is_trivially_relocatable =
+  std::integral_constant<bool, std::is_trivially_copyable<T>::value>;
+
+template<typename Storage>
+using manage_fn_t = void (*)(manage_op,
+                             Storage& /*dst*/,
+                             Storage& /*src*/) /*noexcept*/;
+
+template<typename R, typename... Ts, typename Storage>
+struct vtable<R(Ts...), Storage>
 {
-    using destructor_t = void (*)(raw_handler_storage&) /*noexcept*/;
-    using move_construct_t =
-      void (*)(raw_handler_storage& /*dst*/,
-               raw_handler_storage& /*src*/) /*noexcept*/;
-    using invoke_t = R (*)(raw_handler_storage&, Ts...);
+    using manage_t = manage_fn_t<Storage>;
+    using invoke_t = R (*)(Storage&, Ts...);
+    using executor_t = boost::asio::executor (*)(Storage const&);
+    using allocator_t = allocators::erased_allocator<void> (*)(
+      Storage const&) /*noexcept*/;
+
+    void move_construct(Storage& dst, Storage& src) const noexcept
+    {
+        if (manage == nullptr)
+        {
+            std::memcpy(static_cast<void*>(&dst),
+                        static_cast<void const*>(&src),
+                        sizeof(Storage));
+            return;
+        }
+
+        manage(manage_op::move, dst, src);
+    }
+
+    void destroy(Storage& s) const noexcept
+    {
+        if (manage != nullptr)
+        {
+            manage(manage_op::destroy, s, s);
+        }
+    }
 
     invoke_t invoke;
-    move_construct_t move_construct;
-    destructor_t destroy;
+    manage_t manage; // nullptr if the handler is trivially relocatable
+    executor_t executor;
+    allocator_t allocator;
 };
 
-struct default_vtable_generator_base
+struct no_associated_executor
 {
-    // Use a base class to prevent generation of empty functions for each
-    // completion handler signature
-    static void move_construct(raw_handler_storage&,
-                               raw_handler_storage&) noexcept
+};
+
+// Handlers which don't have an associated executor get the fallback executor
+// of the query.
+template<typename Handler>
+using has_associated_executor = std::integral_constant<
+  bool,
+  !std::is_same<
+    boost::asio::associated_executor_t<Handler, no_associated_executor>,
+    no_associated_executor>::value>;
+
+// Queries of the associated executor and allocator of a stored handler. Like
+// the manage functions, they don't depend on the completion signature.
+template<typename Manager, typename Storage>
+struct associated_generator
+{
+    // Returns an empty executor if the handler has no associated executor, so
+    // that the caller can substitute its fallback.
+    static boost::asio::executor executor(Storage const& s)
+    {
+        return make_executor(Manager::get(s));
+    }
+
+    static allocators::erased_allocator<void> allocator(
+      Storage const& s) noexcept
+    {
+        return allocators::erase_allocator(
+          boost::asio::get_associated_allocator(Manager::get(s)));
+    }
+
+private:
+    template<typename Handler>
+    static boost::asio::executor make_executor(Handler const& h)
+    {
+        return make_executor(h, has_associated_executor<Handler>{});
+    }
+
+    template<typename Handler>
+    static boost::asio::executor make_executor(Handler const& h,
+                                               std::true_type)
     {
+        return make_polymorphic_executor(
+          boost::asio::get_associated_executor(h));
     }
 
-    static void destroy(raw_handler_storage&) noexcept
+    template<typename Handler>
+    static boost::asio::executor make_executor(Handler const&,
+                                               std::false_type) noexcept
     {
+        return boost::asio::executor{};
     }
 };
 
-template<typename R, typename... Ts>
-struct default_vtable_generator<R(Ts...)> : default_vtable_generator_base
+// Used for empty completion handlers and function pointers, which have the
+// default associated executor and allocator.
+template<typename Storage>
+struct default_handler_manager
+  : associated_generator<default_handler_manager<Storage>, Storage>
 {
-    static R invoke(raw_handler_storage&, Ts...)
+    struct no_handler
+    {
+    };
+
+    static no_handler get(Storage const&) noexcept
+    {
+        return no_handler{};
+    }
+};
+
+template<typename R, typename... Ts, typename Storage>
+struct default_vtable_generator<R(Ts...), Storage>
+{
+    static R invoke(Storage&, Ts...)
     {
         throw std::bad_function_call{};
     }
 
-    static constexpr vtable<R(Ts...)> value{invoke, move_construct, destroy};
+    using manager_type = default_handler_manager<Storage>;
+
+    static constexpr vtable<R(Ts...), Storage> value{
+      invoke, nullptr, manager_type::executor, manager_type::allocator};
 };
 
-template<typename R, typename... Ts>
-constexpr vtable<R(Ts...)> default_vtable_generator<R(Ts...)>::value;
+template<typename R, typename... Ts, typename Storage>
+constexpr vtable<R(Ts...), Storage>
+  default_vtable_generator<R(Ts...), Storage>::value;
 
 template<typename Handler>
 struct wrapper_selector
 {
     using inner_alloc_type =
-      detail::allocators::rebound_alloc_t<Handler, wrapper_selector>;
+      detail::allocators::handler_alloc_t<Handler, wrapper_selector>;
     using inner_pointer_type =
       typename std::allocator_traits<inner_alloc_type>::pointer;
     using inner_value_type =
@@ -119,7 +254,7 @@ struct wrapper_selector
 
     allocator_type get_allocator() const noexcept
     {
-        return detail::allocators::rebind_associated<wrapper_selector>(
+        return detail::allocators::rebind_handler_alloc<wrapper_selector>(
           handler_);
     }
 
@@ -167,192 +302,300 @@ struct small_functor
     }
 };
 
-template<typename T>
+template<typename T, typename Storage = raw_handler_storage>
 using can_use_sbo =
   std::integral_constant<bool,
                          std::is_nothrow_move_constructible<T>::value &&
-                           sizeof(T) <= sizeof(raw_handler_storage) &&
-                           alignof(T) <= alignof(raw_handler_storage)>;
-
-struct vtable_generator_void_ptr_base : private default_vtable_generator_base
+                           sizeof(T) <= sizeof(Storage) &&
+                           alignof(T) <= alignof(Storage)>;
+
+// Manage functions depend only on the handler and storage types, so they are
+// shared between completion handlers with different signatures.
+template<typename Handler, typename Storage>
+struct heap_handler_manager
+  : associated_generator<heap_handler_manager<Handler, Storage>, Storage>
 {
-    static void move_construct(raw_handler_storage& dst,
-                               raw_handler_storage& src) noexcept
+    static auto get(Storage const& s) noexcept -> decltype(
+      (static_cast<Handler const*>(s.void_ptr)->handler_))
     {
-        dst.void_ptr = src.void_ptr;
+        return static_cast<Handler const*>(s.void_ptr)->handler_;
     }
 
-    using default_vtable_generator_base::destroy;
+    static void destroy(Storage& s) noexcept
+    {
+        auto* const h = static_cast<Handler*>(s.void_ptr);
+        auto alloc = boost::asio::get_associated_allocator(*h);
+        std::allocator_traits<decltype(alloc)>::destroy(alloc, h);
+        std::allocator_traits<decltype(alloc)>::deallocate(alloc, h, 1);
+    }
+
+    static void manage(manage_op op, Storage& dst, Storage& src) noexcept
+    {
+        switch (op)
+        {
+            case manage_op::move:
+                dst.void_ptr = src.void_ptr;
+                break;
+            case manage_op::destroy:
+                destroy(dst);
+                break;
+        }
+    }
 };
 
-template<typename Handler, typename R, typename... Ts>
-struct vtable_generator<Handler, R(Ts...)> : vtable_generator_void_ptr_base
+template<typename Handler, typename Storage>
+struct sbo_handler_manager
+  : associated_generator<sbo_handler_manager<Handler, Storage>, Storage>
 {
-    static R invoke(raw_handler_storage& s, Ts... args)
+    static auto get(Storage const& s) noexcept -> decltype(
+      (reinterpret_cast<Handler const*>(&s.buffer)->handler_))
     {
-        auto* const h = static_cast<Handler*>(s.void_ptr);
-        BOOST_ASSERT(h != nullptr);
-        auto handler = std::move(*h);
-        // Deallocation-before-invocation guarantee
-        destroy(s);
-        return (handler)(std::forward<Ts>(args)...);
+        return reinterpret_cast<Handler const*>(&s.buffer)->handler_;
     }
 
-    static void destroy(raw_handler_storage& s) noexcept
+    static void destroy(Storage& s) noexcept
     {
-        auto* const h = static_cast<Handler*>(s.void_ptr);
-        auto alloc = boost::asio::get_associated_allocator(*h);
-        std::allocator_traits<decltype(alloc)>::destroy(alloc, h);
-        std::allocator_traits<decltype(alloc)>::deallocate(alloc, h, 1);
+        auto const h = reinterpret_cast<Handler*>(&s.buffer);
+        h->~Handler();
     }
 
-    static constexpr vtable<R(Ts...)> value{invoke, move_construct, destroy};
+    static void manage(manage_op op, Storage& dst, Storage& src) noexcept
+    {
+        switch (op)
+        {
+            case manage_op::move:
+            {
+                static_assert(sizeof(Handler) <= sizeof(dst.buffer),
+                              "dst buffer too small");
+                static_assert(alignof(Handler) <=
+                                alignof(decltype(dst.buffer)),
+                              "dst buffer not aligned properly");
+                auto* const h = reinterpret_cast<Handler*>(&src.buffer);
+                new (&dst.buffer) Handler{std::move(*h)};
+                destroy(src);
+                break;
+            }
+            case manage_op::destroy:
+                destroy(dst);
+                break;
+        }
+    }
+
+    static constexpr manage_fn_t<Storage> value =
+      is_trivially_relocatable<Handler>::value ? nullptr : manage;
 };
 
-template<typename Handler, typename R, typename... Ts>
-constexpr vtable<R(Ts...)> vtable_generator<Handler, R(Ts...)>::value;
+template<typename Handler, typename Storage>
+constexpr manage_fn_t<Storage> sbo_handler_manager<Handler, Storage>::value;
 
-template<typename Handler, typename R, typename... Ts>
-struct vtable_generator<small_functor<Handler>, R(Ts...)>
+template<typename Handler, typename Storage>
+struct referenced_handler_manager
+  : associated_generator<referenced_handler_manager<Handler, Storage>,
+                         Storage>
 {
-    static R invoke(raw_handler_storage& p, Ts... args)
+    static Handler const& get(Storage const& s) noexcept
     {
-        auto* const h = reinterpret_cast<small_functor<Handler>*>(&p.buffer);
-        auto handler = std::move(*h);
-        // Deallocation-before-invocation guarantee
-        destroy(p);
-        return (handler)(std::forward<Ts>(args)...);
+        return *static_cast<Handler const*>(s.void_ptr);
     }
+};
 
-    static void move_construct(raw_handler_storage& dst,
-                               raw_handler_storage& src) noexcept
-    {
-        static_assert(sizeof(small_functor<Handler>) <= sizeof(dst.buffer),
-                      "dst buffer too small");
-        static_assert(alignof(small_functor<Handler>) <=
-                        alignof(decltype(dst.buffer)),
-                      "dst buffer not aligned properly");
-        auto* const h = reinterpret_cast<small_functor<Handler>*>(&src.buffer);
-        new (&dst.buffer) small_functor<Handler>{std::move(*h)};
-        destroy(src);
-    }
+template<typename Handler, typename R, typename... Ts, typename Storage>
+struct vtable_generator<Handler, R(Ts...), Storage>
+{
+    using manager_type = heap_handler_manager<Handler, Storage>;
 
-    static void destroy(raw_handler_storage& s) noexcept
+    static R invoke(Storage& s, Ts... args)
     {
-        auto const h = reinterpret_cast<small_functor<Handler>*>(&s.buffer);
-        h->~small_functor<Handler>();
+        auto* const h = static_cast<Handler*>(s.void_ptr);
+        BOOST_ASSERT(h != nullptr);
+        auto handler = std::move(*h);
+        // Deallocation-before-invocation guarantee
+        manager_type::destroy(s);
+        return (handler)(std::forward<Ts>(args)...);
     }
 
-    static constexpr vtable<R(Ts...)> value{invoke, move_construct, destroy};
+    static constexpr vtable<R(Ts...), Storage> value{invoke,
+                                                     manager_type::manage,
+                                                     manager_type::executor,
+                                                     manager_type::allocator};
 };
 
-template<typename Handler, typename R, typename... Ts>
-constexpr vtable<R(Ts...)>
-  vtable_generator<small_functor<Handler>, R(Ts...)>::value;
+template<typename Handler, typename R, typename... Ts, typename Storage>
+constexpr vtable<R(Ts...), Storage>
+  vtable_generator<Handler, R(Ts...), Storage>::value;
 
-struct vtable_generator_func_ptr_base : private default_vtable_generator_base
+template<typename Handler, typename R, typename... Ts, typename Storage>
+struct vtable_generator<small_functor<Handler>, R(Ts...), Storage>
 {
-    static void move_construct(raw_handler_storage& dst,
-                               raw_handler_storage& src) noexcept
+    using manager_type = sbo_handler_manager<small_functor<Handler>, Storage>;
+
+    static R invoke(Storage& p, Ts... args)
     {
-        dst.func_ptr = src.func_ptr;
+        auto* const h = reinterpret_cast<small_functor<Handler>*>(&p.buffer);
+        auto handler = std::move(*h);
+        // Deallocation-before-invocation guarantee
+        manager_type::destroy(p);
+        return (handler)(std::forward<Ts>(args)...);
     }
 
-    using default_vtable_generator_base::destroy;
+    static constexpr vtable<R(Ts...), Storage> value{invoke,
+                                                     manager_type::value,
+                                                     manager_type::executor,
+                                                     manager_type::allocator};
 };
 
-template<typename U, typename... Vs, typename R, typename... Ts>
-struct vtable_generator<U (*)(Vs...), R(Ts...)> : vtable_generator_func_ptr_base
+template<typename Handler, typename R, typename... Ts, typename Storage>
+constexpr vtable<R(Ts...), Storage>
+  vtable_generator<small_functor<Handler>, R(Ts...), Storage>::value;
+
+template<typename U,
+         typename... Vs,
+         typename R,
+         typename... Ts,
+         typename Storage>
+struct vtable_generator<U (*)(Vs...), R(Ts...), Storage>
 {
-    static R invoke(raw_handler_storage& s, Ts... args)
+    using manager_type = default_handler_manager<Storage>;
+
+    static R invoke(Storage& s, Ts... args)
     {
         auto* const h = reinterpret_cast<U (*)(Vs...)>(s.func_ptr);
         BOOST_ASSERT(h != nullptr);
         return (h)(std::forward<Ts>(args)...);
     }
 
-    static constexpr vtable<R(Ts...)> value{invoke, move_construct, destroy};
+    static constexpr vtable<R(Ts...), Storage> value{
+      invoke, nullptr, manager_type::executor, manager_type::allocator};
 };
 
-template<typename U, typename... Vs, typename R, typename... Ts>
-constexpr vtable<R(Ts...)> vtable_generator<U (*)(Vs...), R(Ts...)>::value;
+template<typename U,
+         typename... Vs,
+         typename R,
+         typename... Ts,
+         typename Storage>
+constexpr vtable<R(Ts...), Storage>
+  vtable_generator<U (*)(Vs...), R(Ts...), Storage>::value;
 
-template<typename Handler, typename R, typename... Ts>
-struct vtable_generator<std::reference_wrapper<Handler>, R(Ts...)>
-  : vtable_generator_void_ptr_base
+template<typename Handler, typename R, typename... Ts, typename Storage>
+struct vtable_generator<std::reference_wrapper<Handler>, R(Ts...), Storage>
 {
-    static R invoke(raw_handler_storage& s, Ts... args)
+    using manager_type = referenced_handler_manager<Handler, Storage>;
+
+    static R invoke(Storage& s, Ts... args)
     {
         auto* const h = static_cast<Handler*>(s.void_ptr);
         BOOST_ASSERT(h != nullptr);
         return (*h)(std::forward<Ts>(args)...);
     }
 
-    static constexpr vtable<R(Ts...)> value{invoke, move_construct, destroy};
+    static constexpr vtable<R(Ts...), Storage> value{
+      invoke, nullptr, manager_type::executor, manager_type::allocator};
 };
 
-template<typename Handler, typename R, typename... Ts>
-constexpr vtable<R(Ts...)>
-  vtable_generator<std::reference_wrapper<Handler>, R(Ts...)>::value;
+template<typename Handler, typename R, typename... Ts, typename Storage>
+constexpr vtable<R(Ts...), Storage>
+  vtable_generator<std::reference_wrapper<Handler>, R(Ts...), Storage>::value;
 
-template<typename Signature, typename U, typename... Ts>
+template<typename Signature, typename Storage, typename U, typename... Ts>
 void
-allocate_handler(raw_handler_storage& s,
-                 vtable<Signature> const*& v,
+allocate_handler(Storage& s,
+                 vtable<Signature, Storage> const*& v,
                  U (*f)(Ts...)) noexcept
 {
     s.func_ptr = reinterpret_cast<decltype(s.func_ptr)>(f);
-    v = &vtable_generator<U (*)(Ts...), Signature>::value;
+    v = &vtable_generator<U (*)(Ts...), Signature, Storage>::value;
 }
 
-template<typename Signature, typename Handler>
+template<typename Signature, typename Storage, typename Handler>
 void
-allocate_handler_sbo(raw_handler_storage& s,
-                     vtable<Signature> const*& v,
+allocate_handler_sbo(Storage& s,
+                     vtable<Signature, Storage> const*& v,
                      Handler&& h,
                      std::false_type)
 {
     using handler_type =
       wrapper_selector<typename std::remove_reference<Handler>::type>;
-    auto alloc = detail::allocators::rebind_associated<handler_type>(h);
+    auto alloc = detail::allocators::rebind_handler_alloc<handler_type>(h);
     auto handler_ptr =
       detail::allocators::allocate_unique(alloc, std::forward<Handler>(h));
     s.void_ptr = handler_ptr.release();
-    v = &vtable_generator<handler_type, Signature>::value;
+    v = &vtable_generator<handler_type, Signature, Storage>::value;
 }
 
-template<typename Signature, typename Handler>
+template<typename Signature, typename Storage, typename Handler>
 void
-allocate_handler_sbo(raw_handler_storage& s,
-                     vtable<Signature> const*& v,
+allocate_handler_sbo(Storage& s,
+                     vtable<Signature, Storage> const*& v,
                      Handler&& handler,
                      std::true_type)
 {
     using handler_type =
       small_functor<typename std::remove_reference<Handler>::type>;
     ::new (static_cast<void*>(&s.buffer)) handler_type{std::forward<Handler>(handler)};
-    v = &vtable_generator<handler_type, Signature>::value;
+    v = &vtable_generator<handler_type, Signature, Storage>::value;
 }
 
-template<typename Signature, typename Handler>
+template<typename Signature, typename Storage, typename Handler>
 void
-allocate_handler(raw_handler_storage& s,
-                 vtable<Signature> const*& v,
+allocate_handler(Storage& s,
+                 vtable<Signature, Storage> const*& v,
                  Handler&& handler)
 {
     using handler_type = typename std::remove_reference<Handler>::type;
-    allocate_handler_sbo<Signature>(
-      s, v, std::forward<Handler>(handler), can_use_sbo<handler_type>{});
+    allocate_handler_sbo<Signature>(s,
+                                    v,
+                                    std::forward<Handler>(handler),
+                                    can_use_sbo<handler_type, Storage>{});
 }
 
-template<typename Signature, typename Handler>
+template<typename Signature, typename Storage, typename Handler>
 void
-allocate_handler(raw_handler_storage& s,
-                 vtable<Signature> const*& v,
+allocate_handler(Storage& s,
+                 vtable<Signature, Storage> const*& v,
                  std::reference_wrapper<Handler> handler)
 {
     s.void_ptr = &handler.get();
-    v = &vtable_generator<std::reference_wrapper<Handler>, Signature>::value;
+    v = &vtable_generator<std::reference_wrapper<Handler>, Signature, Storage>::
+      value;
+}
+
+struct inplace_tag
+{
+};
+
+template<typename Signature, typename Storage, typename U, typename... Ts>
+void
+allocate_handler_inplace(Storage& s,
+                         vtable<Signature, Storage> const*& v,
+                         U (*f)(Ts...)) noexcept
+{
+    detail::allocate_handler(s, v, f);
+}
+
+template<typename Signature, typename Storage, typename Handler>
+void
+allocate_handler_inplace(Storage& s,
+                         vtable<Signature, Storage> const*& v,
+                         std::reference_wrapper<Handler> handler) noexcept
+{
+    detail::allocate_handler(s, v, handler);
+}
+
+template<typename Signature, typename Storage, typename Handler>
+void
+allocate_handler_inplace(Storage& s,
+                         vtable<Signature, Storage> const*& v,
+                         Handler&& handler)
+{
+    using handler_type = typename std::remove_reference<Handler>::type;
+    static_assert(std::is_nothrow_move_constructible<handler_type>::value,
+                  "Handler must be nothrow move constructible");
+    static_assert(sizeof(handler_type) <= sizeof(Storage),
+                  "Handler exceeds the inplace capacity");
+    static_assert(alignof(handler_type) <= alignof(Storage),
+                  "Handler exceeds the inplace alignment");
+    allocate_handler_sbo<Signature>(
+      s, v, std::forward<Handler>(handler), std::true_type{});
 }
 
 } // namespace detail
@@ -0,0 +1,198 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_DETAIL_HAZARD_POINTERS_HPP
+#define NETU_DETAIL_HAZARD_POINTERS_HPP
+
+#include <netu/cache_line_layout.hpp>
+
+#include <boost/assert.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+
+namespace netu
+{
+namespace detail
+{
+
+// Per-thread set of hazard pointers. Records are never freed, a record
+// released by an exiting thread is reused by the next thread that needs one.
+struct hazard_record
+{
+    static constexpr std::size_t slot_count = 4;
+
+    // Keeps the slots of different threads off each other's cache lines
+    char head_padding_[cache_line_size];
+    std::atomic<void const*> slots_[slot_count];
+    std::size_t depth_ = 0; // Only accessed by the owning thread
+    std::atomic<bool> active_{true};
+    hazard_record* next_ = nullptr;
+    char tail_padding_[cache_line_size];
+};
+
+class hazard_domain
+{
+public:
+    // Returns the record owned by the calling thread
+    static hazard_record& local();
+
+    // Returns true if any thread currently protects p
+    static bool is_protected(void const* p) noexcept;
+
+private:
+    class holder
+    {
+    public:
+        holder();
+
+        holder(holder const&) = delete;
+        holder& operator=(holder const&) = delete;
+
+        ~holder();
+
+        hazard_record& record_;
+    };
+
+    static std::atomic<hazard_record*>& head() noexcept;
+
+    static hazard_record& acquire();
+};
+
+// Protects the object pointed to by an atomic pointer from being reclaimed
+// for the lifetime of the guard. A thread can hold at most
+// hazard_record::slot_count guards at a time, constructing another one throws
+// std::length_error.
+template<typename T>
+class hazard_ptr
+{
+public:
+    explicit hazard_ptr(std::atomic<T*> const& src);
+
+    hazard_ptr(hazard_ptr const&) = delete;
+    hazard_ptr& operator=(hazard_ptr const&) = delete;
+
+    ~hazard_ptr();
+
+    T const* get() const noexcept;
+
+private:
+    hazard_record& record_;
+    T* ptr_;
+};
+
+inline hazard_record&
+hazard_domain::local()
+{
+    static thread_local holder h;
+    return h.record_;
+}
+
+inline bool
+hazard_domain::is_protected(void const* p) noexcept
+{
+    for (auto r = head().load(std::memory_order_acquire); r != nullptr;
+         r = r->next_)
+    {
+        for (auto& slot : r->slots_)
+        {
+            if (slot.load(std::memory_order_seq_cst) == p)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+inline hazard_domain::holder::holder()
+  : record_{hazard_domain::acquire()}
+{
+}
+
+inline hazard_domain::holder::~holder()
+{
+    BOOST_ASSERT(record_.depth_ == 0);
+    record_.active_.store(false, std::memory_order_release);
+}
+
+inline std::atomic<hazard_record*>&
+hazard_domain::head() noexcept
+{
+    static std::atomic<hazard_record*> h{nullptr};
+    return h;
+}
+
+inline hazard_record&
+hazard_domain::acquire()
+{
+    auto& h = head();
+    for (auto r = h.load(std::memory_order_acquire); r != nullptr;
+         r = r->next_)
+    {
+        bool expected = false;
+        if (!r->active_.load(std::memory_order_relaxed) &&
+            r->active_.compare_exchange_strong(expected, true))
+        {
+            return *r;
+        }
+    }
+
+    auto r = new hazard_record{};
+    r->next_ = h.load(std::memory_order_relaxed);
+    while (!h.compare_exchange_weak(r->next_,
+                                    r,
+                                    std::memory_order_release,
+                                    std::memory_order_relaxed))
+    {
+    }
+    return *r;
+}
+
+template<typename T>
+hazard_ptr<T>::hazard_ptr(std::atomic<T*> const& src)
+  : record_{hazard_domain::local()}
+  , ptr_{src.load(std::memory_order_relaxed)}
+{
+    if (record_.depth_ == hazard_record::slot_count)
+    {
+        throw std::length_error{"Too many nested hazard pointers"};
+    }
+
+    auto& slot = record_.slots_[record_.depth_++];
+    for (;;)
+    {
+        slot.store(ptr_, std::memory_order_seq_cst);
+        auto p = src.load(std::memory_order_seq_cst);
+        if (p == ptr_)
+        {
+            break;
+        }
+        ptr_ = p;
+    }
+}
+
+template<typename T>
+hazard_ptr<T>::~hazard_ptr()
+{
+    record_.slots_[--record_.depth_].store(nullptr, std::memory_order_release);
+}
+
+template<typename T>
+T const*
+hazard_ptr<T>::get() const noexcept
+{
+    return ptr_;
+}
+
+} // namespace detail
+} // namespace netu
+
+#endif // NETU_DETAIL_HAZARD_POINTERS_HPP
@@ -0,0 +1,363 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_DETAIL_RECYCLING_ALLOCATOR_HPP
+#define NETU_DETAIL_RECYCLING_ALLOCATOR_HPP
+
+#include <netu/detail/allocators.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace netu
+{
+namespace detail
+{
+namespace allocators
+{
+
+// Per-thread cache of recently freed memory blocks, grouped into power of 2
+// size classes. Only the owning thread touches a cache, so neither allocation
+// nor deallocation need any synchronization. A block freed on a different
+// thread than the one it was allocated on simply migrates to that thread's
+// cache.
+class thread_cache
+{
+public:
+    static constexpr std::size_t min_block_size = 32;
+    static constexpr std::size_t class_count = 6; // 32 to 1024 bytes
+    static constexpr std::size_t slots_per_class = 4;
+
+    static void* allocate(std::size_t size)
+    {
+        auto const c = size_class(size);
+        if (c == class_count)
+        {
+            return ::operator new(size);
+        }
+
+        auto& tc = instance();
+        if (tc.counts_[c] > 0)
+        {
+            return tc.slots_[c][--tc.counts_[c]];
+        }
+
+        return ::operator new(min_block_size << c);
+    }
+
+    static void deallocate(void* p, std::size_t size) noexcept
+    {
+        auto const c = size_class(size);
+        if (c != class_count)
+        {
+            auto& tc = instance();
+            if (!tc.disabled_ && tc.counts_[c] < slots_per_class)
+            {
+                tc.slots_[c][tc.counts_[c]++] = p;
+                return;
+            }
+        }
+
+        ::operator delete(p);
+    }
+
+private:
+    // Flushes the cache when the thread exits. The cache itself is trivially
+    // destructible, so it remains usable (in pass-through mode) by destructors
+    // of other thread_local objects which run after this one.
+    struct cleanup
+    {
+        explicit cleanup(thread_cache& tc) noexcept
+          : tc_{tc}
+        {
+        }
+
+        ~cleanup()
+        {
+            tc_.disabled_ = true;
+            for (std::size_t c = 0; c < class_count; ++c)
+            {
+                while (tc_.counts_[c] > 0)
+                {
+                    ::operator delete(tc_.slots_[c][--tc_.counts_[c]]);
+                }
+            }
+        }
+
+        thread_cache& tc_;
+    };
+
+    static thread_cache& instance() noexcept
+    {
+        static thread_local thread_cache tc;
+        static thread_local cleanup guard{tc};
+        return tc;
+    }
+
+    static std::size_t size_class(std::size_t size) noexcept
+    {
+        std::size_t c = 0;
+        while (c < class_count && (min_block_size << c) < size)
+        {
+            ++c;
+        }
+        return c;
+    }
+
+    void* slots_[class_count][slots_per_class];
+    std::size_t counts_[class_count];
+    bool disabled_;
+};
+
+template<typename T>
+class recycling_allocator
+{
+public:
+    using value_type = T;
+
+    recycling_allocator() = default;
+
+    template<typename U>
+    recycling_allocator(recycling_allocator<U> const&) noexcept
+    {
+    }
+
+    template<typename U>
+    explicit recycling_allocator(std::allocator<U> const&) noexcept
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t),
+                      "Over-aligned types are not supported.");
+        return static_cast<T*>(thread_cache::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        thread_cache::deallocate(p, n * sizeof(T));
+    }
+
+    template<typename U>
+    friend bool operator==(recycling_allocator const&,
+                           recycling_allocator<U> const&) noexcept
+    {
+        return true;
+    }
+
+    template<typename U>
+    friend bool operator!=(recycling_allocator const&,
+                           recycling_allocator<U> const&) noexcept
+    {
+        return false;
+    }
+};
+
+// Memory blocks reused by the allocations of a sequential chain of
+// operations, e.g. the outstanding read of a stream. There are two blocks,
+// because completing an operation through a strand allocates a second one
+// while the first is still in use. Allocations which don't fit in a free
+// block go to the heap. The owner gives up the slot with release() and the
+// slot is destroyed once all the memory allocated from it has been returned,
+// so that operations destroyed after the owner don't access freed memory.
+class recycling_slot
+{
+public:
+    static constexpr std::size_t block_count = 2;
+
+    struct releaser
+    {
+        void operator()(recycling_slot* s) const noexcept
+        {
+            s->release();
+        }
+    };
+
+    using pointer = std::unique_ptr<recycling_slot, releaser>;
+
+    static pointer create()
+    {
+        return pointer{new recycling_slot};
+    }
+
+    recycling_slot(recycling_slot const&) = delete;
+    recycling_slot& operator=(recycling_slot const&) = delete;
+
+    void* allocate(std::size_t size)
+    {
+        for (auto& b : blocks_)
+        {
+            if (b.ptr_ != nullptr && !b.in_use_ && size <= b.capacity_)
+            {
+                b.in_use_ = true;
+                ++outstanding_;
+                return b.ptr_;
+            }
+        }
+
+        auto p = ::operator new(size);
+        ++outstanding_;
+        return p;
+    }
+
+    void deallocate(void* p, std::size_t size) noexcept
+    {
+        --outstanding_;
+        for (auto& b : blocks_)
+        {
+            if (b.ptr_ == p)
+            {
+                b.in_use_ = false;
+                destroy_if_unused();
+                return;
+            }
+        }
+
+        // Keep the larger blocks, so that the slot converges to the largest
+        // allocations of the chain.
+        for (auto& b : blocks_)
+        {
+            if (!released_ && !b.in_use_ && size > b.capacity_)
+            {
+                ::operator delete(b.ptr_);
+                b.ptr_ = p;
+                b.capacity_ = size;
+                return;
+            }
+        }
+
+        ::operator delete(p);
+        destroy_if_unused();
+    }
+
+private:
+    struct block
+    {
+        void* ptr_ = nullptr;
+        std::size_t capacity_ = 0;
+        bool in_use_ = false;
+    };
+
+    recycling_slot() = default;
+
+    ~recycling_slot()
+    {
+        for (auto& b : blocks_)
+        {
+            ::operator delete(b.ptr_);
+        }
+    }
+
+    void release() noexcept
+    {
+        released_ = true;
+        destroy_if_unused();
+    }
+
+    void destroy_if_unused() noexcept
+    {
+        if (released_ && outstanding_ == 0)
+        {
+            delete this;
+        }
+    }
+
+    block blocks_[block_count];
+    std::size_t outstanding_ = 0;
+    bool released_ = false;
+};
+
+template<typename T>
+class slot_allocator
+{
+public:
+    using value_type = T;
+
+    explicit slot_allocator(recycling_slot& slot) noexcept
+      : slot_{&slot}
+    {
+    }
+
+    template<typename U>
+    slot_allocator(slot_allocator<U> const& other) noexcept
+      : slot_{&other.slot()}
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t),
+                      "Over-aligned types are not supported.");
+        return static_cast<T*>(slot_->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        slot_->deallocate(p, n * sizeof(T));
+    }
+
+    recycling_slot& slot() const noexcept
+    {
+        return *slot_;
+    }
+
+    template<typename U>
+    friend bool operator==(slot_allocator const& a,
+                           slot_allocator<U> const& b) noexcept
+    {
+        return &a.slot() == &b.slot();
+    }
+
+    template<typename U>
+    friend bool operator!=(slot_allocator const& a,
+                           slot_allocator<U> const& b) noexcept
+    {
+        return &a.slot() != &b.slot();
+    }
+
+private:
+    recycling_slot* slot_;
+};
+
+template<typename T>
+struct is_std_allocator : std::false_type
+{
+};
+
+template<typename T>
+struct is_std_allocator<std::allocator<T>> : std::true_type
+{
+};
+
+// Handlers without a custom associated allocator have their memory recycled
+// through the thread_cache, everything else goes through the associated
+// allocator.
+template<typename T, typename U>
+using handler_alloc_t = typename std::conditional<
+  is_std_allocator<boost::asio::associated_allocator_t<T>>::value &&
+    alignof(T) <= alignof(std::max_align_t),
+  recycling_allocator<U>,
+  rebound_alloc_t<T, U>>::type;
+
+template<typename ReboundType, typename T>
+auto
+rebind_handler_alloc(T const& t) noexcept -> handler_alloc_t<T, ReboundType>
+{
+    return handler_alloc_t<T, ReboundType>{
+      boost::asio::get_associated_allocator(t)};
+}
+
+} // namespace allocators
+} // namespace detail
+} // namespace netu
+
+#endif // NETU_DETAIL_RECYCLING_ALLOCATOR_HPP
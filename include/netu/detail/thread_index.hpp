@@ -0,0 +1,35 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_DETAIL_THREAD_INDEX_HPP
+#define NETU_DETAIL_THREAD_INDEX_HPP
+
+#include <atomic>
+#include <cstddef>
+
+namespace netu
+{
+namespace detail
+{
+
+// Threads are assigned consecutive indices when they first call this
+// function, which spreads them evenly across per-thread slots or shards.
+inline std::size_t
+this_thread_index() noexcept
+{
+    static std::atomic<std::size_t> next{0};
+    static thread_local std::size_t const index =
+      next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+} // namespace detail
+} // namespace netu
+
+#endif // NETU_DETAIL_THREAD_INDEX_HPP
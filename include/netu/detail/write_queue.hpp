@@ -0,0 +1,156 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_DETAIL_WRITE_QUEUE_HPP
+#define NETU_DETAIL_WRITE_QUEUE_HPP
+
+#include <netu/deferred_io_completion.hpp>
+#include <netu/detail/type_traits.hpp>
+
+#include <boost/asio/buffer.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace netu
+{
+namespace detail
+{
+
+// Buffers of complete writes queued by concurrent producers. A single flusher
+// at a time gathers the queued buffers into one write_some and hands out the
+// handlers of the writes whose bytes have all been transferred.
+class write_queue
+{
+public:
+    using handler_type = deferred_io_completion::handler_type;
+
+    // Same as the number of buffers Asio passes to a single writev
+    static constexpr std::size_t max_buffers = 64;
+
+    // Returns true if the caller became the flusher and has to start a flush
+    template<typename ConstBuffers>
+    bool push(ConstBuffers const& buffers, handler_type&& handler);
+
+    // Flusher only. Returns the buffers to be written next.
+    std::vector<boost::asio::const_buffer> const& prepare();
+
+    // Flusher only. Consumes n written bytes, pushes the handlers of the
+    // finished writes to finished and returns true if there are more writes to
+    // flush. All queued writes fail if ec is set. The caller stops being the
+    // flusher if there are no more writes, so finished must not be owned by
+    // the queue.
+    bool consume(boost::system::error_code ec,
+                 std::size_t n,
+                 deferred_io_batch& finished);
+
+private:
+    struct write
+    {
+        handler_type handler_;
+        std::size_t remaining_;
+        std::size_t written_;
+    };
+
+    std::mutex mutex_;
+    std::deque<boost::asio::const_buffer> buffers_;
+    std::deque<write> writes_;
+    bool flushing_ = false;
+
+    std::vector<boost::asio::const_buffer> gathered_;
+};
+
+template<typename ConstBuffers>
+bool
+write_queue::push(ConstBuffers const& buffers, handler_type&& handler)
+{
+    std::lock_guard<std::mutex> guard{mutex_};
+    std::size_t size = 0;
+    for (auto it = boost::asio::buffer_sequence_begin(buffers);
+         it != boost::asio::buffer_sequence_end(buffers);
+         ++it)
+    {
+        boost::asio::const_buffer b{*it};
+        if (b.size() > 0)
+        {
+            buffers_.push_back(b);
+            size += b.size();
+        }
+    }
+    writes_.push_back(write{std::move(handler), size, 0});
+
+    return !detail::exchange(flushing_, true);
+}
+
+inline std::vector<boost::asio::const_buffer> const&
+write_queue::prepare()
+{
+    std::lock_guard<std::mutex> guard{mutex_};
+    auto const n =
+      buffers_.size() < max_buffers ? buffers_.size() : max_buffers;
+    gathered_.assign(buffers_.begin(), buffers_.begin() + n);
+    return gathered_;
+}
+
+inline bool
+write_queue::consume(boost::system::error_code ec,
+                     std::size_t n,
+                     deferred_io_batch& finished)
+{
+    std::lock_guard<std::mutex> guard{mutex_};
+    if (ec)
+    {
+        for (auto& w : writes_)
+        {
+            finished.push(std::move(w.handler_), ec, w.written_);
+        }
+        writes_.clear();
+        buffers_.clear();
+        flushing_ = false;
+        return false;
+    }
+
+    for (auto left = n; left > 0;)
+    {
+        auto& b = buffers_.front();
+        if (b.size() > left)
+        {
+            b += left;
+            break;
+        }
+        left -= b.size();
+        buffers_.pop_front();
+    }
+
+    while (!writes_.empty())
+    {
+        auto& w = writes_.front();
+        auto const consumed = std::min(w.remaining_, n);
+        w.remaining_ -= consumed;
+        w.written_ += consumed;
+        n -= consumed;
+        if (w.remaining_ > 0)
+        {
+            break;
+        }
+        finished.push(std::move(w.handler_), ec, w.written_);
+        writes_.pop_front();
+    }
+
+    flushing_ = !writes_.empty();
+    return flushing_;
+}
+
+} // namespace detail
+} // namespace netu
+
+#endif // NETU_DETAIL_WRITE_QUEUE_HPP
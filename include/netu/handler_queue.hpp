@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_HANDLER_QUEUE_HPP
+#define NETU_HANDLER_QUEUE_HPP
+
+#include <netu/completion_handler.hpp>
+
+#include <atomic>
+
+namespace netu
+{
+
+// Intrusive, lock-free multi-producer/single-consumer queue of completion
+// handlers. Nodes are recycled, so in the steady state neither push nor drain
+// allocate.
+//
+// A queue is either consumed manually, with push() and drain(), or by an
+// executor, with post(). Mixing the two on one queue throws std::logic_error.
+// Handlers are invoked inline by the consumer, so their associated executors
+// (e.g. strands) aren't used.
+template<typename Signature,
+         std::size_t Capacity = detail::default_handler_capacity,
+         std::size_t Alignment = detail::default_handler_alignment>
+class handler_queue
+{
+public:
+    using handler_type = completion_handler<Signature, Capacity, Alignment>;
+
+    explicit handler_queue(std::size_t batch_size = 64) noexcept;
+
+    handler_queue(handler_queue&&) = delete;
+    handler_queue(handler_queue const&) = delete;
+
+    handler_queue& operator=(handler_queue&&) = delete;
+    handler_queue& operator=(handler_queue const&) = delete;
+
+    ~handler_queue();
+
+    // May be called from any thread. The handler is invoked by drain().
+    template<typename Handler>
+    void push(Handler&& handler);
+
+    // Pushes the handler and, unless a drain is already pending, posts a
+    // single operation to ex which invokes the queued handlers in batches.
+    // That operation is the consumer of the queue, so ex may be run by any
+    // number of threads. If a handler throws, the exception propagates out of
+    // ex and the remaining handlers are invoked by another drain operation.
+    // Only available for handlers which take no arguments.
+    template<typename Executor, typename Handler>
+    void post(Executor const& ex, Handler&& handler);
+
+    // Consumer only. Invokes up to max queued handlers with args and returns
+    // the number of invoked handlers.
+    template<typename... Args>
+    std::size_t drain(std::size_t max, Args const&... args);
+
+private:
+    struct node
+    {
+        std::atomic<node*> next_{nullptr};
+        handler_type handler_;
+    };
+
+    struct node_stash;
+
+    enum class usage : unsigned char
+    {
+        unknown,
+        push,
+        post
+    };
+
+    template<typename Executor>
+    class drain_op;
+
+    static node_stash& stash() noexcept;
+
+    void use(usage u);
+
+    template<typename Handler>
+    void enqueue_handler(Handler&& handler);
+
+    template<typename... Args>
+    void consume(std::size_t max, std::size_t& invoked, Args const&... args);
+
+    node* acquire_node();
+    void recycle(node* n) noexcept;
+    void enqueue(node* n) noexcept;
+    node* dequeue() noexcept;
+
+    std::atomic<node*> head_;
+    node* tail_;
+    node stub_;
+    std::atomic<node*> free_{nullptr};
+    // Number of posted handlers which haven't been invoked yet
+    std::atomic<std::size_t> posted_{0};
+    std::atomic<usage> usage_{usage::unknown};
+    std::size_t batch_size_;
+};
+
+} // namespace netu
+
+#include <netu/impl/handler_queue.hpp>
+
+#endif // NETU_HANDLER_QUEUE_HPP
@@ -0,0 +1,93 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_IMPL_ADAPTIVE_MUTEX_HPP
+#define NETU_IMPL_ADAPTIVE_MUTEX_HPP
+
+#include <netu/adaptive_mutex.hpp>
+
+#include <netu/detail/futex.hpp>
+
+namespace netu
+{
+
+constexpr int adaptive_mutex::spin_rounds;
+constexpr int adaptive_mutex::max_backoff;
+
+inline void
+adaptive_mutex::lock() noexcept
+{
+    if (try_lock() || spin())
+    {
+        return;
+    }
+    park();
+}
+
+inline bool
+adaptive_mutex::try_lock() noexcept
+{
+    int expected = unlocked;
+    return state_.compare_exchange_strong(
+      expected, locked, std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+inline void
+adaptive_mutex::unlock() noexcept
+{
+    if (state_.exchange(unlocked, std::memory_order_release) == contended)
+    {
+        detail::futex_wake_one(state_);
+    }
+}
+
+inline bool
+adaptive_mutex::spin() noexcept
+{
+    int backoff = 1;
+    for (int round = 0; round < spin_rounds; ++round)
+    {
+        for (int i = 0; i < backoff; ++i)
+        {
+            detail::cpu_relax();
+        }
+        backoff = backoff < max_backoff ? backoff * 2 : max_backoff;
+
+        // Don't try to grab the lock unless it's free, in order to avoid
+        // stealing the cache line from the owner.
+        auto s = state_.load(std::memory_order_relaxed);
+        if (s == unlocked && try_lock())
+        {
+            return true;
+        }
+
+        // Somebody is already parked, spinning would only delay us
+        if (s == contended)
+        {
+            break;
+        }
+    }
+    return false;
+}
+
+inline void
+adaptive_mutex::park() noexcept
+{
+    // Marking the lock as contended makes the owner wake up a parked thread.
+    // The lock has to be taken in the contended state too, since there may
+    // be other threads parked.
+    while (state_.exchange(contended, std::memory_order_acquire) != unlocked)
+    {
+        detail::futex_wait(state_, contended);
+    }
+}
+
+} // namespace netu
+
+#endif // NETU_IMPL_ADAPTIVE_MUTEX_HPP
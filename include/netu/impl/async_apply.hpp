@@ -0,0 +1,158 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_IMPL_ASYNC_APPLY_HPP
+#define NETU_IMPL_ASYNC_APPLY_HPP
+
+#include <netu/async_apply.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+
+namespace netu
+{
+
+namespace detail
+{
+
+template<typename T,
+         typename Layout,
+         typename Callable,
+         typename Executor,
+         typename CompletionHandler>
+class async_apply_op
+{
+public:
+    using executor_type =
+      boost::asio::associated_executor_t<CompletionHandler, Executor>;
+    using allocator_type =
+      boost::asio::associated_allocator_t<CompletionHandler>;
+
+    template<typename DeducedCallable>
+    async_apply_op(synchronized_value<T, async_mutex, Layout>& sv,
+                   DeducedCallable&& f,
+                   Executor const& ex,
+                   CompletionHandler&& h)
+      : sv_{sv}
+      , f_{std::forward<DeducedCallable>(f)}
+      , ex_{ex}
+      , handler_{std::move(h)}
+    {
+    }
+
+    executor_type get_executor() const noexcept
+    {
+        return boost::asio::get_associated_executor(handler_, ex_);
+    }
+
+    allocator_type get_allocator() const noexcept
+    {
+        return boost::asio::get_associated_allocator(handler_);
+    }
+
+    // Invoked with the lock held
+    void operator()()
+    {
+        using result_type = decltype(f_(std::declval<T&>()));
+        invoke(std::is_void<result_type>{});
+    }
+
+private:
+    struct unlock_guard
+    {
+        ~unlock_guard()
+        {
+            mutex_.unlock();
+        }
+
+        async_mutex& mutex_;
+    };
+
+    void invoke(std::true_type)
+    {
+        {
+            unlock_guard guard{synchronized_value_access::mutex(sv_)};
+            f_(synchronized_value_access::value(sv_));
+        }
+        handler_();
+    }
+
+    void invoke(std::false_type)
+    {
+        using result_type =
+          typename std::decay<decltype(f_(std::declval<T&>()))>::type;
+
+        auto result = [this]() -> result_type {
+            unlock_guard guard{synchronized_value_access::mutex(sv_)};
+            return f_(synchronized_value_access::value(sv_));
+        }();
+        handler_(std::move(result));
+    }
+
+    synchronized_value<T, async_mutex, Layout>& sv_;
+    Callable f_;
+    Executor ex_;
+    CompletionHandler handler_;
+};
+
+} // namespace detail
+
+template<typename ExecutionContext,
+         typename T,
+         typename Layout,
+         typename Callable,
+         typename CompletionToken>
+auto
+async_apply(ExecutionContext& ctx,
+            synchronized_value<T, async_mutex, Layout>& sv,
+            Callable&& f,
+            CompletionToken&& tok)
+  -> detail::completion_result_t<CompletionToken,
+                                 detail::apply_signature_t<Callable, T>>
+{
+    using signature_type = detail::apply_signature_t<Callable, T>;
+    using executor_type = detail::executor_from_context_t<ExecutionContext>;
+
+    detail::completion_t<CompletionToken, signature_type> init{tok};
+    using ch_t = typename decltype(init)::completion_handler_type;
+    using op_t = detail::async_apply_op<T,
+                                        Layout,
+                                        typename std::decay<Callable>::type,
+                                        executor_type,
+                                        ch_t>;
+
+    detail::synchronized_value_access::mutex(sv).async_lock(
+      op_t{sv,
+           std::forward<Callable>(f),
+           detail::get_executor_from_context(ctx),
+           std::move(init.completion_handler)});
+    return init.result.get();
+}
+
+template<typename T,
+         typename Layout,
+         typename Callable,
+         typename CompletionToken>
+auto
+async_apply(synchronized_value<T, async_mutex, Layout>& sv,
+            Callable&& f,
+            CompletionToken&& tok)
+  -> detail::completion_result_t<CompletionToken,
+                                 detail::apply_signature_t<Callable, T>>
+{
+    boost::asio::system_executor ex;
+    return async_apply(ex,
+                       sv,
+                       std::forward<Callable>(f),
+                       std::forward<CompletionToken>(tok));
+}
+
+} // namespace netu
+
+#endif // NETU_IMPL_ASYNC_APPLY_HPP
@@ -0,0 +1,113 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_IMPL_ASYNC_MUTEX_HPP
+#define NETU_IMPL_ASYNC_MUTEX_HPP
+
+#include <netu/async_mutex.hpp>
+
+#include <boost/asio/post.hpp>
+
+namespace netu
+{
+
+inline void
+async_mutex::lock()
+{
+    std::unique_lock<std::mutex> guard{mutex_};
+    ++blocked_;
+    cv_.wait(guard, [this]() { return !locked_; });
+    --blocked_;
+    locked_ = true;
+}
+
+inline bool
+async_mutex::try_lock()
+{
+    std::lock_guard<std::mutex> guard{mutex_};
+    return !detail::exchange(locked_, true);
+}
+
+inline void
+async_mutex::unlock()
+{
+    std::unique_lock<std::mutex> guard{mutex_};
+    BOOST_ASSERT(locked_);
+    if (waiters_.empty())
+    {
+        locked_ = false;
+        auto const notify = blocked_ > 0;
+        guard.unlock();
+        if (notify)
+        {
+            cv_.notify_one();
+        }
+        return;
+    }
+
+    // The lock stays held, ownership passes to the first queued handler
+    auto w = std::move(waiters_.front());
+    waiters_.pop_front();
+    guard.unlock();
+
+    try
+    {
+        boost::asio::post(std::move(w.handler_));
+    }
+    catch (...)
+    {
+        // The handler is gone, so the lock passes to the next waiter or is
+        // released if there's none.
+        unlock();
+        throw;
+    }
+}
+
+inline bool
+async_mutex::lock_or_enqueue(handler_type& h)
+{
+    std::lock_guard<std::mutex> guard{mutex_};
+    if (!locked_)
+    {
+        locked_ = true;
+        return true;
+    }
+
+    waiters_.emplace_back(std::move(h));
+    return false;
+}
+
+template<typename CompletionToken>
+auto
+async_mutex::async_lock(CompletionToken&& tok)
+  -> detail::completion_result_t<CompletionToken, void()>
+{
+    detail::completion_t<CompletionToken, void()> init{tok};
+    handler_type h{std::move(init.completion_handler)};
+
+    if (lock_or_enqueue(h))
+    {
+        // Never invoke the handler from within the initiating function
+        try
+        {
+            boost::asio::post(std::move(h));
+        }
+        catch (...)
+        {
+            unlock();
+            throw;
+        }
+    }
+
+    return init.result.get();
+}
+
+} // namespace netu
+
+#endif // NETU_IMPL_ASYNC_MUTEX_HPP
@@ -0,0 +1,194 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_IMPL_COMBINING_VALUE_HPP
+#define NETU_IMPL_COMBINING_VALUE_HPP
+
+#include <netu/combining_value.hpp>
+
+#include <netu/detail/futex.hpp>
+#include <netu/detail/thread_index.hpp>
+
+#include <boost/optional.hpp>
+
+#include <thread>
+
+namespace netu
+{
+
+namespace detail
+{
+
+template<typename R>
+class combining_result
+{
+public:
+    template<typename Callable, typename U>
+    void set(Callable&& f, U& v)
+    {
+        result_.emplace(std::forward<Callable>(f)(v));
+    }
+
+    R get()
+    {
+        return std::forward<R>(*result_);
+    }
+
+private:
+    boost::optional<R> result_;
+};
+
+template<>
+class combining_result<void>
+{
+public:
+    template<typename Callable, typename U>
+    void set(Callable&& f, U& v)
+    {
+        std::forward<Callable>(f)(v);
+    }
+
+    void get() noexcept
+    {
+    }
+};
+
+} // namespace detail
+
+template<typename T, typename Lockable, std::size_t SlotCount>
+constexpr std::size_t combining_value<T, Lockable, SlotCount>::slot_count;
+
+template<typename T, typename Lockable, std::size_t SlotCount>
+template<typename Arg1, typename... Args>
+combining_value<T, Lockable, SlotCount>::combining_value(Arg1&& arg1,
+                                                         Args&&... args)
+  : value_{std::forward<Arg1>(arg1), std::forward<Args>(args)...}
+{
+}
+
+template<typename T, typename Lockable, std::size_t SlotCount>
+auto
+combining_value<T, Lockable, SlotCount>::local_slot() noexcept
+  -> std::atomic<request*>&
+{
+    return slots_[detail::this_thread_index() % SlotCount].request_;
+}
+
+template<typename T, typename Lockable, std::size_t SlotCount>
+void
+combining_value<T, Lockable, SlotCount>::wait_or_combine(request& r)
+{
+    for (int spins = 0;; ++spins)
+    {
+        if (r.done_.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        if (mutex_.try_lock())
+        {
+            // Our request was published before the lock was acquired, so it
+            // has been executed by now, either by us or by the previous owner.
+            combine();
+            mutex_.unlock();
+            return;
+        }
+
+        if (spins < 64)
+        {
+            detail::cpu_relax();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+template<typename T, typename Lockable, std::size_t SlotCount>
+void
+combining_value<T, Lockable, SlotCount>::combine() noexcept
+{
+    for (auto& s : slots_)
+    {
+        auto r = s.request_.load(std::memory_order_acquire);
+        if (r == nullptr)
+        {
+            continue;
+        }
+
+        try
+        {
+            r->op_(value_);
+        }
+        catch (...)
+        {
+            r->error_ = std::current_exception();
+        }
+
+        // The publisher may destroy the request as soon as it's marked done
+        s.request_.store(nullptr, std::memory_order_relaxed);
+        r->done_.store(true, std::memory_order_release);
+    }
+}
+
+template<typename Callable, typename U, typename L, std::size_t S>
+auto
+apply(Callable&& f, combining_value<U, L, S>& cv)
+  -> decltype(std::forward<Callable>(f)(std::declval<U&>()))
+{
+    using result_type =
+      decltype(std::forward<Callable>(f)(std::declval<U&>()));
+    using request_type = typename combining_value<U, L, S>::request;
+
+    // Uncontended, skip publishing and scanning the slots
+    if (cv.mutex_.try_lock())
+    {
+        std::lock_guard<L> guard{cv.mutex_, std::adopt_lock};
+        return std::forward<Callable>(f)(cv.value_);
+    }
+
+    auto& slot = cv.local_slot();
+    request_type* expected = nullptr;
+    detail::combining_result<result_type> result;
+    auto op = [&](U& v) { result.set(std::forward<Callable>(f), v); };
+    request_type r{op};
+
+    if (!slot.compare_exchange_strong(expected,
+                                      &r,
+                                      std::memory_order_release,
+                                      std::memory_order_relaxed))
+    {
+        // The slot is used by another thread, take the lock like a combiner
+        // would, but execute our callable directly.
+        std::lock_guard<L> guard{cv.mutex_};
+        cv.combine();
+        return std::forward<Callable>(f)(cv.value_);
+    }
+
+    cv.wait_or_combine(r);
+    if (r.error_)
+    {
+        std::rethrow_exception(r.error_);
+    }
+    return result.get();
+}
+
+template<typename Callable, typename U, typename L, std::size_t S>
+auto
+apply(Callable&& f, combining_value<U, L, S> const& cv)
+  -> decltype(std::forward<Callable>(f)(std::declval<U const&>()))
+{
+    std::lock_guard<L> guard{cv.mutex_};
+    return std::forward<Callable>(f)(cv.value_);
+}
+
+} // namespace netu
+
+#endif // NETU_IMPL_COMBINING_VALUE_HPP
@@ -15,64 +15,79 @@
 namespace netu
 {
 
-template<typename R, typename... Ts>
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
 template<typename Handler, class>
-completion_handler<R(Ts...)>::completion_handler(Handler&& handler)
+completion_handler<R(Ts...), C, A>::completion_handler(Handler&& handler)
 {
     detail::allocate_handler<R(Ts...)>(
       storage_, vtable_, std::forward<Handler>(handler));
 }
 
-template<typename R, typename... Ts>
-completion_handler<R(Ts...)>::completion_handler(std::nullptr_t) noexcept
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
+template<typename Handler>
+completion_handler<R(Ts...), C, A>::completion_handler(detail::inplace_tag,
+                                                       Handler&& handler)
+{
+    detail::allocate_handler_inplace<R(Ts...)>(
+      storage_, vtable_, std::forward<Handler>(handler));
+}
+
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
+completion_handler<R(Ts...), C, A>::completion_handler(std::nullptr_t) noexcept
   : completion_handler{}
 {
 }
 
-template<typename R, typename... Ts>
-completion_handler<R(Ts...)>::completion_handler(
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
+completion_handler<R(Ts...), C, A>::completion_handler(
   completion_handler&& other) noexcept
   : vtable_{detail::exchange(other.vtable_, default_vtable())}
 {
     vtable_->move_construct(storage_, other.storage_);
 }
 
-template<typename R, typename... Ts>
-completion_handler<R(Ts...)>::~completion_handler()
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
+completion_handler<R(Ts...), C, A>::~completion_handler()
 {
     vtable_->destroy(storage_);
 }
 
-template<typename R, typename... Ts>
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
 template<typename Handler, class>
-completion_handler<R(Ts...)>&
-completion_handler<R(Ts...)>::operator=(Handler&& handler)
+completion_handler<R(Ts...), C, A>&
+completion_handler<R(Ts...), C, A>::operator=(Handler&& handler)
 {
     *this = completion_handler{std::forward<Handler>(handler)};
     return *this;
 }
 
-template<typename R, typename... Ts>
-completion_handler<R(Ts...)>&
-completion_handler<R(Ts...)>::operator=(completion_handler&& other) noexcept
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
+completion_handler<R(Ts...), C, A>&
+completion_handler<R(Ts...), C, A>::operator=(
+  completion_handler&& other) noexcept
 {
-    completion_handler{std::move(other)}.swap(*this);
+    if (this != &other)
+    {
+        vtable_->destroy(storage_);
+        vtable_ = detail::exchange(other.vtable_, default_vtable());
+        vtable_->move_construct(storage_, other.storage_);
+    }
     return *this;
 }
 
-template<typename R, typename... Ts>
-completion_handler<R(Ts...)>& completion_handler<R(Ts...)>::operator=(
-  std::nullptr_t) noexcept
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
+completion_handler<R(Ts...), C, A>& completion_handler<R(Ts...), C, A>::
+operator=(std::nullptr_t) noexcept
 {
     *this = completion_handler{};
     return *this;
 }
 
-template<typename R, typename... Ts>
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
 void
-completion_handler<R(Ts...)>::swap(completion_handler& other) noexcept
+completion_handler<R(Ts...), C, A>::swap(completion_handler& other) noexcept
 {
-    detail::raw_handler_storage tmp;
+    storage_type tmp;
     vtable_->move_construct(tmp, storage_);
     other.vtable_->move_construct(storage_, other.storage_);
     vtable_->move_construct(other.storage_, tmp);
@@ -81,10 +96,10 @@ completion_handler<R(Ts...)>::swap(completion_handler& other) noexcept
     swap(vtable_, other.vtable_);
 }
 
-template<typename R, typename... Ts>
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
 template<typename... Args>
 R
-completion_handler<R(Ts...)>::invoke(Args&&... args)
+completion_handler<R(Ts...), C, A>::invoke(Args&&... args)
 {
     // Need to clear the vtable ptr in order to avoid calling the destructor of
     // the stored handler twice, if invocation of the handler throws.
@@ -92,51 +107,79 @@ completion_handler<R(Ts...)>::invoke(Args&&... args)
     return v->invoke(storage_, std::forward<Args>(args)...);
 }
 
-template<typename R, typename... Ts>
-detail::vtable<R(Ts...)> const*
-completion_handler<R(Ts...)>::default_vtable()
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
+template<typename... Args>
+R
+completion_handler<R(Ts...), C, A>::operator()(Args&&... args)
+{
+    return invoke(std::forward<Args>(args)...);
+}
+
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
+template<typename Executor>
+detail::erased_executor<Executor>
+completion_handler<R(Ts...), C, A>::get_executor(Executor const& ex) const
+{
+    return detail::erased_executor<Executor>{ex, vtable_->executor(storage_)};
+}
+
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
+auto
+completion_handler<R(Ts...), C, A>::get_allocator() const noexcept
+  -> allocator_type
+{
+    return vtable_->allocator(storage_);
+}
+
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
+auto
+completion_handler<R(Ts...), C, A>::default_vtable() -> vtable_type const*
 {
-    return &detail::default_vtable_generator<R(Ts...)>::value;
+    return &detail::default_vtable_generator<R(Ts...), storage_type>::value;
 }
 
-template<typename R, typename... Ts>
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
 bool
-operator==(completion_handler<R(Ts...)> const& lhs, std::nullptr_t) noexcept
+operator==(completion_handler<R(Ts...), C, A> const& lhs,
+           std::nullptr_t) noexcept
 {
     return !lhs;
 }
 
-template<typename R, typename... Ts>
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
 bool
-operator==(std::nullptr_t lhs, completion_handler<R(Ts...)> const& rhs) noexcept
+operator==(std::nullptr_t lhs,
+           completion_handler<R(Ts...), C, A> const& rhs) noexcept
 {
     return rhs == lhs;
 }
 
-template<typename R, typename... Ts>
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
 bool
-operator!=(completion_handler<R(Ts...)> const& lhs, std::nullptr_t rhs) noexcept
+operator!=(completion_handler<R(Ts...), C, A> const& lhs,
+           std::nullptr_t rhs) noexcept
 {
     return !(lhs == rhs);
 }
 
-template<typename R, typename... Ts>
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
 bool
-operator!=(std::nullptr_t lhs, completion_handler<R(Ts...)> const& rhs) noexcept
+operator!=(std::nullptr_t lhs,
+           completion_handler<R(Ts...), C, A> const& rhs) noexcept
 {
     return rhs != lhs;
 }
 
-template<typename R, typename... Ts>
-completion_handler<R(Ts...)>::operator bool() const noexcept
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
+completion_handler<R(Ts...), C, A>::operator bool() const noexcept
 {
     return vtable_ != default_vtable();
 }
 
-template<typename R, typename... Ts>
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
 void
-swap(completion_handler<R(Ts...)>& lhs,
-     completion_handler<R(Ts...)>& rhs) noexcept
+swap(completion_handler<R(Ts...), C, A>& lhs,
+     completion_handler<R(Ts...), C, A>& rhs) noexcept
 {
     return lhs.swap(rhs);
 }
@@ -0,0 +1,56 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_IMPL_COMPLETION_HANDLER_REF_HPP
+#define NETU_IMPL_COMPLETION_HANDLER_REF_HPP
+
+#include <netu/completion_handler_ref.hpp>
+
+#include <memory>
+
+namespace netu
+{
+
+template<typename R, typename... Ts>
+template<typename U, typename... Vs>
+completion_handler_ref<R(Ts...)>::completion_handler_ref(
+  U (*f)(Vs...)) noexcept
+  : invoke_{&detail::vtable_generator<U (*)(Vs...), R(Ts...), storage_type>::
+              invoke}
+{
+    BOOST_ASSERT(f != nullptr);
+    storage_.func_ptr = reinterpret_cast<decltype(storage_.func_ptr)>(f);
+}
+
+template<typename R, typename... Ts>
+template<typename Handler, class>
+completion_handler_ref<R(Ts...)>::completion_handler_ref(
+  Handler&& handler) noexcept
+  : invoke_{&detail::vtable_generator<
+              std::reference_wrapper<
+                typename std::remove_reference<Handler>::type>,
+              R(Ts...),
+              storage_type>::invoke}
+{
+    storage_.void_ptr =
+      const_cast<void*>(static_cast<void const*>(std::addressof(handler)));
+}
+
+template<typename R, typename... Ts>
+template<typename... Args>
+R
+completion_handler_ref<R(Ts...)>::operator()(Args&&... args) const
+{
+    auto s = storage_;
+    return invoke_(s, std::forward<Args>(args)...);
+}
+
+} // namespace netu
+
+#endif // NETU_IMPL_COMPLETION_HANDLER_REF_HPP
@@ -0,0 +1,139 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_IMPL_DEFERRED_IO_COMPLETION_HPP
+#define NETU_IMPL_DEFERRED_IO_COMPLETION_HPP
+
+#include <netu/deferred_io_completion.hpp>
+
+#include <iterator>
+
+namespace netu
+{
+
+static_assert(std::is_nothrow_move_constructible<deferred_io_completion>::value,
+              "Batches must not copy completions when growing");
+
+template<typename Handler, class>
+deferred_io_completion::deferred_io_completion(
+  Handler&& handler,
+  boost::system::error_code ec,
+  std::size_t bytes_transferred)
+  : handler_{std::forward<Handler>(handler)}
+  , ec_{ec}
+  , bytes_transferred_{bytes_transferred}
+{
+}
+
+inline void
+deferred_io_completion::operator()()
+{
+    handler_.invoke(ec_, bytes_transferred_);
+}
+
+inline deferred_io_completion::operator bool() const noexcept
+{
+    return static_cast<bool>(handler_);
+}
+
+inline boost::system::error_code const&
+deferred_io_completion::error() const noexcept
+{
+    return ec_;
+}
+
+inline std::size_t
+deferred_io_completion::bytes_transferred() const noexcept
+{
+    return bytes_transferred_;
+}
+
+template<typename Executor>
+detail::erased_executor<Executor>
+deferred_io_completion::get_executor(Executor const& ex) const
+{
+    return handler_.get_executor(ex);
+}
+
+inline deferred_io_batch::deferred_io_batch(std::size_t capacity)
+{
+    pending_.reserve(capacity);
+    running_.reserve(capacity);
+}
+
+template<typename Handler>
+void
+deferred_io_batch::push(Handler&& handler,
+                        boost::system::error_code ec,
+                        std::size_t bytes_transferred)
+{
+    pending_.emplace_back(
+      std::forward<Handler>(handler), ec, bytes_transferred);
+}
+
+inline void
+deferred_io_batch::push(deferred_io_completion&& completion)
+{
+    pending_.push_back(std::move(completion));
+}
+
+inline std::size_t
+deferred_io_batch::invoke()
+{
+    BOOST_ASSERT(running_.empty());
+    pending_.swap(running_);
+
+    // Leaves running_ empty for the next batch, even if moving the remaining
+    // completions back to pending_ throws.
+    struct clear_guard
+    {
+        ~clear_guard()
+        {
+            v_.clear();
+        }
+
+        std::vector<deferred_io_completion>& v_;
+    } guard{running_};
+
+    std::size_t i = 0;
+    try
+    {
+        for (; i < running_.size(); ++i)
+        {
+            running_[i]();
+        }
+    }
+    catch (...)
+    {
+        // Keep the completions which haven't run yet in front of the ones
+        // pushed by the invoked handlers.
+        pending_.insert(pending_.begin(),
+                        std::make_move_iterator(running_.begin() + i + 1),
+                        std::make_move_iterator(running_.end()));
+        throw;
+    }
+
+    return i;
+}
+
+inline std::size_t
+deferred_io_batch::size() const noexcept
+{
+    return pending_.size();
+}
+
+inline bool
+deferred_io_batch::empty() const noexcept
+{
+    return pending_.empty();
+}
+
+} // namespace netu
+
+#endif // NETU_IMPL_DEFERRED_IO_COMPLETION_HPP
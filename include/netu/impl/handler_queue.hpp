@@ -0,0 +1,295 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_IMPL_HANDLER_QUEUE_HPP
+#define NETU_IMPL_HANDLER_QUEUE_HPP
+
+#include <netu/handler_queue.hpp>
+
+#include <boost/asio/post.hpp>
+
+#include <stdexcept>
+
+namespace netu
+{
+
+// Nodes of all queues with the same handler type are interchangeable.
+// Producers take whole free lists from queues into a thread local stash, which
+// avoids the ABA problem of popping single nodes from a shared stack.
+template<typename S, std::size_t C, std::size_t A>
+struct handler_queue<S, C, A>::node_stash
+{
+    ~node_stash()
+    {
+        while (head_ != nullptr)
+        {
+            auto next = head_->next_.load(std::memory_order_relaxed);
+            delete detail::exchange(head_, next);
+        }
+    }
+
+    node* head_ = nullptr;
+};
+
+template<typename S, std::size_t C, std::size_t A>
+template<typename Executor>
+class handler_queue<S, C, A>::drain_op
+{
+public:
+    drain_op(handler_queue& q, Executor const& ex)
+      : queue_{q}
+      , ex_{ex}
+    {
+    }
+
+    // Only one drain operation exists at a time: a new one is posted only
+    // after the previous one has accounted for all the handlers it was
+    // scheduled for and returned.
+    void operator()()
+    {
+        std::size_t n = 0;
+        try
+        {
+            queue_.consume(queue_.batch_size_, n);
+        }
+        catch (...)
+        {
+            // The throwing handler has been consumed as well
+            complete(n);
+            throw;
+        }
+        complete(n);
+    }
+
+private:
+    // Accounts for n invoked handlers and reposts the operation if more
+    // handlers have been posted in the meantime.
+    void complete(std::size_t n)
+    {
+        if (queue_.posted_.fetch_sub(n, std::memory_order_acq_rel) != n)
+        {
+            auto const ex = ex_;
+            boost::asio::post(ex, std::move(*this));
+        }
+    }
+
+    handler_queue& queue_;
+    Executor ex_;
+};
+
+template<typename S, std::size_t C, std::size_t A>
+handler_queue<S, C, A>::handler_queue(std::size_t batch_size) noexcept
+  : head_{&stub_}
+  , tail_{&stub_}
+  , batch_size_{batch_size}
+{
+}
+
+template<typename S, std::size_t C, std::size_t A>
+handler_queue<S, C, A>::~handler_queue()
+{
+    while (auto* n = dequeue())
+    {
+        delete n;
+    }
+
+    auto* n = free_.load(std::memory_order_acquire);
+    while (n != nullptr)
+    {
+        delete detail::exchange(n, n->next_.load(std::memory_order_relaxed));
+    }
+}
+
+template<typename S, std::size_t C, std::size_t A>
+template<typename Handler>
+void
+handler_queue<S, C, A>::push(Handler&& handler)
+{
+    use(usage::push);
+    enqueue_handler(std::forward<Handler>(handler));
+}
+
+template<typename S, std::size_t C, std::size_t A>
+template<typename Executor, typename Handler>
+void
+handler_queue<S, C, A>::post(Executor const& ex, Handler&& handler)
+{
+    use(usage::post);
+    enqueue_handler(std::forward<Handler>(handler));
+    if (posted_.fetch_add(1, std::memory_order_acq_rel) == 0)
+    {
+        boost::asio::post(ex, drain_op<Executor>{*this, ex});
+    }
+}
+
+template<typename S, std::size_t C, std::size_t A>
+template<typename... Args>
+std::size_t
+handler_queue<S, C, A>::drain(std::size_t max, Args const&... args)
+{
+    use(usage::push);
+    std::size_t invoked = 0;
+    consume(max, invoked, args...);
+    return invoked;
+}
+
+// Only one kind of consumer may drain a queue: a manual drain() would race with
+// a drain operation and handlers drained by drain() would never be accounted
+// for in posted_.
+template<typename S, std::size_t C, std::size_t A>
+void
+handler_queue<S, C, A>::use(usage u)
+{
+    auto current = usage_.load(std::memory_order_relaxed);
+    if (current == usage::unknown &&
+        usage_.compare_exchange_strong(
+          current, u, std::memory_order_relaxed, std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    if (current != u)
+    {
+        throw std::logic_error{"push() and post() can't be mixed"};
+    }
+}
+
+template<typename S, std::size_t C, std::size_t A>
+template<typename Handler>
+void
+handler_queue<S, C, A>::enqueue_handler(Handler&& handler)
+{
+    auto* n = acquire_node();
+    try
+    {
+        n->handler_ = std::forward<Handler>(handler);
+    }
+    catch (...)
+    {
+        auto& s = stash();
+        n->next_.store(s.head_, std::memory_order_relaxed);
+        s.head_ = n;
+        throw;
+    }
+    enqueue(n);
+}
+
+template<typename S, std::size_t C, std::size_t A>
+template<typename... Args>
+void
+handler_queue<S, C, A>::consume(std::size_t max,
+                                std::size_t& invoked,
+                                Args const&... args)
+{
+    while (invoked < max)
+    {
+        auto* n = dequeue();
+        if (n == nullptr)
+        {
+            break;
+        }
+
+        // Recycle the node before invocation, so that the handler can reuse it
+        auto handler = std::move(n->handler_);
+        recycle(n);
+        ++invoked;
+        handler.invoke(args...);
+    }
+}
+
+template<typename S, std::size_t C, std::size_t A>
+auto
+handler_queue<S, C, A>::stash() noexcept -> node_stash&
+{
+    static thread_local node_stash s;
+    return s;
+}
+
+template<typename S, std::size_t C, std::size_t A>
+auto
+handler_queue<S, C, A>::acquire_node() -> node*
+{
+    auto& s = stash();
+    if (s.head_ == nullptr)
+    {
+        s.head_ = free_.exchange(nullptr, std::memory_order_acquire);
+    }
+
+    if (s.head_ != nullptr)
+    {
+        return detail::exchange(s.head_,
+                                s.head_->next_.load(std::memory_order_relaxed));
+    }
+
+    return new node;
+}
+
+template<typename S, std::size_t C, std::size_t A>
+void
+handler_queue<S, C, A>::recycle(node* n) noexcept
+{
+    auto* top = free_.load(std::memory_order_relaxed);
+    do
+    {
+        n->next_.store(top, std::memory_order_relaxed);
+    } while (!free_.compare_exchange_weak(
+      top, n, std::memory_order_release, std::memory_order_relaxed));
+}
+
+template<typename S, std::size_t C, std::size_t A>
+void
+handler_queue<S, C, A>::enqueue(node* n) noexcept
+{
+    n->next_.store(nullptr, std::memory_order_relaxed);
+    auto* prev = head_.exchange(n, std::memory_order_acq_rel);
+    prev->next_.store(n, std::memory_order_release);
+}
+
+template<typename S, std::size_t C, std::size_t A>
+auto
+handler_queue<S, C, A>::dequeue() noexcept -> node*
+{
+    auto* tail = tail_;
+    auto* next = tail->next_.load(std::memory_order_acquire);
+    if (tail == &stub_)
+    {
+        if (next == nullptr)
+        {
+            return nullptr;
+        }
+        tail_ = tail = next;
+        next = next->next_.load(std::memory_order_acquire);
+    }
+
+    if (next != nullptr)
+    {
+        tail_ = next;
+        return tail;
+    }
+
+    if (tail != head_.load(std::memory_order_acquire))
+    {
+        // A producer is in the middle of a push
+        return nullptr;
+    }
+
+    enqueue(&stub_);
+    next = tail->next_.load(std::memory_order_acquire);
+    if (next != nullptr)
+    {
+        tail_ = next;
+        return tail;
+    }
+
+    return nullptr;
+}
+
+} // namespace netu
+
+#endif // NETU_IMPL_HANDLER_QUEUE_HPP
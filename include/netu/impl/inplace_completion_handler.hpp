@@ -0,0 +1,105 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_IMPL_INPLACE_COMPLETION_HANDLER_HPP
+#define NETU_IMPL_INPLACE_COMPLETION_HANDLER_HPP
+
+#include <netu/inplace_completion_handler.hpp>
+
+namespace netu
+{
+
+template<typename S, std::size_t C, std::size_t A>
+inplace_completion_handler<S, C, A>::inplace_completion_handler(
+  std::nullptr_t) noexcept
+  : inplace_completion_handler{}
+{
+}
+
+template<typename S, std::size_t C, std::size_t A>
+template<typename Handler, class>
+inplace_completion_handler<S, C, A>::inplace_completion_handler(
+  Handler&& handler) noexcept(std::
+                                is_nothrow_constructible<
+                                  detail::remove_cv_ref_t<Handler>,
+                                  Handler&&>::value)
+  : base_type{detail::inplace_tag{}, std::forward<Handler>(handler)}
+{
+}
+
+template<typename S, std::size_t C, std::size_t A>
+template<typename Handler, class>
+inplace_completion_handler<S, C, A>&
+inplace_completion_handler<S, C, A>::operator=(Handler&& handler) noexcept(
+  std::is_nothrow_constructible<detail::remove_cv_ref_t<Handler>,
+                                Handler&&>::value)
+{
+    *this = inplace_completion_handler{std::forward<Handler>(handler)};
+    return *this;
+}
+
+template<typename S, std::size_t C, std::size_t A>
+inplace_completion_handler<S, C, A>& inplace_completion_handler<S, C, A>::
+operator=(std::nullptr_t) noexcept
+{
+    *this = inplace_completion_handler{};
+    return *this;
+}
+
+template<typename S, std::size_t C, std::size_t A>
+void
+inplace_completion_handler<S, C, A>::swap(
+  inplace_completion_handler& other) noexcept
+{
+    base_type::swap(other);
+}
+
+template<typename S, std::size_t C, std::size_t A>
+bool
+operator==(inplace_completion_handler<S, C, A> const& lhs,
+           std::nullptr_t) noexcept
+{
+    return !lhs;
+}
+
+template<typename S, std::size_t C, std::size_t A>
+bool
+operator==(std::nullptr_t lhs,
+           inplace_completion_handler<S, C, A> const& rhs) noexcept
+{
+    return rhs == lhs;
+}
+
+template<typename S, std::size_t C, std::size_t A>
+bool
+operator!=(inplace_completion_handler<S, C, A> const& lhs,
+           std::nullptr_t rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+template<typename S, std::size_t C, std::size_t A>
+bool
+operator!=(std::nullptr_t lhs,
+           inplace_completion_handler<S, C, A> const& rhs) noexcept
+{
+    return rhs != lhs;
+}
+
+template<typename S, std::size_t C, std::size_t A>
+void
+swap(inplace_completion_handler<S, C, A>& lhs,
+     inplace_completion_handler<S, C, A>& rhs) noexcept
+{
+    return lhs.swap(rhs);
+}
+
+} // namespace netu
+
+#endif // NETU_IMPL_INPLACE_COMPLETION_HANDLER_HPP
@@ -0,0 +1,378 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_IMPL_INSTRUMENTED_LOCKABLE_HPP
+#define NETU_IMPL_INSTRUMENTED_LOCKABLE_HPP
+
+#include <netu/instrumented_lockable.hpp>
+
+#include <algorithm>
+#include <ostream>
+
+namespace netu
+{
+
+inline lock_stats::lock_stats(std::string name)
+  : name_{std::move(name)}
+{
+}
+
+inline std::string const&
+lock_stats::name() const noexcept
+{
+    return name_;
+}
+
+inline std::uint64_t
+lock_stats::acquisitions() const noexcept
+{
+    return acquisitions_.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t
+lock_stats::contentions() const noexcept
+{
+    return contentions_.load(std::memory_order_relaxed);
+}
+
+inline auto
+lock_stats::wait_histogram() const noexcept -> histogram_type
+{
+    return load(wait_);
+}
+
+inline auto
+lock_stats::hold_histogram() const noexcept -> histogram_type
+{
+    return load(hold_);
+}
+
+inline void
+lock_stats::record_acquisition(bool contended, duration_type wait) noexcept
+{
+    acquisitions_.fetch_add(1, std::memory_order_relaxed);
+    if (contended)
+    {
+        contentions_.fetch_add(1, std::memory_order_relaxed);
+    }
+    wait_[bucket(wait)].fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void
+lock_stats::record_hold(duration_type hold) noexcept
+{
+    hold_[bucket(hold)].fetch_add(1, std::memory_order_relaxed);
+}
+
+inline std::size_t
+lock_stats::bucket(duration_type d) noexcept
+{
+    if (d.count() <= 0)
+    {
+        return 0;
+    }
+
+    auto ns = static_cast<std::uint64_t>(d.count());
+    std::size_t b = 0;
+    while (ns != 0 && b < bucket_count - 1)
+    {
+        ns >>= 1;
+        ++b;
+    }
+    return b;
+}
+
+inline auto
+lock_stats::percentile(histogram_type const& h, unsigned p) -> duration_type
+{
+    std::uint64_t total = 0;
+    for (auto n : h)
+    {
+        total += n;
+    }
+
+    std::uint64_t const rank = (total * p + 99) / 100;
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < bucket_count; ++b)
+    {
+        seen += h[b];
+        if (seen >= rank && seen > 0)
+        {
+            return duration_type{std::uint64_t{1} << b};
+        }
+    }
+    return duration_type{0};
+}
+
+inline auto
+lock_stats::load(atomic_histogram_type const& h) noexcept -> histogram_type
+{
+    histogram_type r;
+    for (std::size_t b = 0; b < bucket_count; ++b)
+    {
+        r[b] = h[b].load(std::memory_order_relaxed);
+    }
+    return r;
+}
+
+inline lock_registry&
+lock_registry::instance()
+{
+    static lock_registry r;
+    return r;
+}
+
+inline void
+lock_registry::add(lock_stats const& s)
+{
+    std::lock_guard<std::mutex> guard{mutex_};
+    stats_.push_back(&s);
+}
+
+inline void
+lock_registry::remove(lock_stats const& s) noexcept
+{
+    std::lock_guard<std::mutex> guard{mutex_};
+    stats_.erase(std::remove(stats_.begin(), stats_.end(), &s), stats_.end());
+}
+
+template<typename Callable>
+void
+lock_registry::for_each(Callable&& f) const
+{
+    std::lock_guard<std::mutex> guard{mutex_};
+    for (auto s : stats_)
+    {
+        f(*s);
+    }
+}
+
+inline void
+lock_registry::dump(std::ostream& os) const
+{
+    for_each([&os](lock_stats const& s) {
+        auto const wait = s.wait_histogram();
+        auto const hold = s.hold_histogram();
+        os << s.name() << ": acquisitions=" << s.acquisitions()
+           << " contentions=" << s.contentions()
+           << " wait_p50<=" << lock_stats::percentile(wait, 50).count()
+           << "ns wait_p99<=" << lock_stats::percentile(wait, 99).count()
+           << "ns hold_p50<=" << lock_stats::percentile(hold, 50).count()
+           << "ns hold_p99<=" << lock_stats::percentile(hold, 99).count()
+           << "ns\n";
+    });
+}
+
+template<typename Lockable>
+constexpr bool instrumented_lockable<Lockable>::enabled;
+
+#if defined(NETU_DISABLE_LOCK_INSTRUMENTATION)
+
+template<typename Lockable>
+instrumented_lockable<Lockable>::instrumented_lockable(std::string const&)
+{
+}
+
+template<typename Lockable>
+lock_stats const&
+instrumented_lockable<Lockable>::stats() noexcept
+{
+    static lock_stats const s{std::string{}};
+    return s;
+}
+
+#else
+
+template<typename Lockable>
+instrumented_lockable<Lockable>::instrumented_lockable()
+  : instrumented_lockable{std::string{}}
+{
+}
+
+template<typename Lockable>
+instrumented_lockable<Lockable>::instrumented_lockable(std::string name)
+  : stats_{std::move(name)}
+{
+    lock_registry::instance().add(stats_);
+}
+
+template<typename Lockable>
+instrumented_lockable<Lockable>::~instrumented_lockable()
+{
+    lock_registry::instance().remove(stats_);
+}
+
+template<typename Lockable>
+void
+instrumented_lockable<Lockable>::lock()
+{
+    lock(detail::has_try_lock<Lockable>{});
+}
+
+template<typename Lockable>
+template<typename L>
+auto
+instrumented_lockable<Lockable>::try_lock()
+  -> decltype(std::declval<L&>().try_lock())
+{
+    auto const acquired = lockable_.try_lock();
+    if (acquired)
+    {
+        record_uncontended();
+    }
+    return acquired;
+}
+
+template<typename Lockable>
+template<typename Clock, typename Duration, typename L>
+auto
+instrumented_lockable<Lockable>::try_lock_until(
+  std::chrono::time_point<Clock, Duration> const& tp)
+  -> decltype(std::declval<L&>().try_lock_until(tp))
+{
+    if (lockable_.try_lock())
+    {
+        record_uncontended();
+        return true;
+    }
+
+    auto const start = clock_type::now();
+    auto const acquired = lockable_.try_lock_until(tp);
+    if (acquired)
+    {
+        record_contended(start);
+    }
+    return acquired;
+}
+
+template<typename Lockable>
+void
+instrumented_lockable<Lockable>::unlock()
+{
+    stats_.record_hold(clock_type::now() - acquired_at_);
+    lockable_.unlock();
+}
+
+template<typename Lockable>
+template<typename L>
+auto
+instrumented_lockable<Lockable>::lock_shared()
+  -> decltype(std::declval<L&>().lock_shared())
+{
+    if (lockable_.try_lock_shared())
+    {
+        stats_.record_acquisition(false, lock_stats::duration_type{0});
+        return;
+    }
+
+    auto const start = clock_type::now();
+    lockable_.lock_shared();
+    stats_.record_acquisition(true, clock_type::now() - start);
+}
+
+template<typename Lockable>
+template<typename L>
+auto
+instrumented_lockable<Lockable>::try_lock_shared()
+  -> decltype(std::declval<L&>().try_lock_shared())
+{
+    auto const acquired = lockable_.try_lock_shared();
+    if (acquired)
+    {
+        stats_.record_acquisition(false, lock_stats::duration_type{0});
+    }
+    return acquired;
+}
+
+template<typename Lockable>
+template<typename Clock, typename Duration, typename L>
+auto
+instrumented_lockable<Lockable>::try_lock_shared_until(
+  std::chrono::time_point<Clock, Duration> const& tp)
+  -> decltype(std::declval<L&>().try_lock_shared_until(tp))
+{
+    if (lockable_.try_lock_shared())
+    {
+        stats_.record_acquisition(false, lock_stats::duration_type{0});
+        return true;
+    }
+
+    auto const start = clock_type::now();
+    auto const acquired = lockable_.try_lock_shared_until(tp);
+    if (acquired)
+    {
+        stats_.record_acquisition(true, clock_type::now() - start);
+    }
+    return acquired;
+}
+
+template<typename Lockable>
+template<typename L>
+auto
+instrumented_lockable<Lockable>::unlock_shared()
+  -> decltype(std::declval<L&>().unlock_shared())
+{
+    return lockable_.unlock_shared();
+}
+
+template<typename Lockable>
+lock_stats const&
+instrumented_lockable<Lockable>::stats() const noexcept
+{
+    return stats_;
+}
+
+template<typename Lockable>
+void
+instrumented_lockable<Lockable>::lock(std::true_type)
+{
+    if (lockable_.try_lock())
+    {
+        record_uncontended();
+        return;
+    }
+
+    auto const start = clock_type::now();
+    lockable_.lock();
+    record_contended(start);
+}
+
+template<typename Lockable>
+void
+instrumented_lockable<Lockable>::lock(std::false_type)
+{
+    // A BasicLockable can't be tried, so contention is unknown
+    auto const start = clock_type::now();
+    lockable_.lock();
+    acquired_at_ = clock_type::now();
+    stats_.record_acquisition(false, acquired_at_ - start);
+}
+
+template<typename Lockable>
+void
+instrumented_lockable<Lockable>::record_uncontended()
+{
+    acquired_at_ = clock_type::now();
+    stats_.record_acquisition(false, lock_stats::duration_type{0});
+}
+
+template<typename Lockable>
+void
+instrumented_lockable<Lockable>::record_contended(
+  clock_type::time_point start)
+{
+    acquired_at_ = clock_type::now();
+    stats_.record_acquisition(true, acquired_at_ - start);
+}
+
+#endif // defined(NETU_DISABLE_LOCK_INSTRUMENTATION)
+
+} // namespace netu
+
+#endif // NETU_IMPL_INSTRUMENTED_LOCKABLE_HPP
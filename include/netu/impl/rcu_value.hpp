@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_IMPL_RCU_VALUE_HPP
+#define NETU_IMPL_RCU_VALUE_HPP
+
+#include <netu/rcu_value.hpp>
+
+#include <netu/detail/type_traits.hpp>
+
+#include <boost/mp11/tuple.hpp>
+
+#include <memory>
+#include <tuple>
+
+namespace netu
+{
+
+namespace detail
+{
+
+template<typename Callable>
+struct invoke_with_hazards
+{
+    template<typename... Nodes>
+    auto operator()(hazard_ptr<Nodes> const&... hps)
+      -> decltype(std::declval<Callable>()(hps.get()->value_...))
+    {
+        return std::forward<Callable>(f)(hps.get()->value_...);
+    }
+
+    Callable&& f;
+};
+
+} // namespace detail
+
+// Publishes the updated copy when a mutating apply() returns normally
+template<typename T, typename Lockable>
+class rcu_value<T, Lockable>::publisher
+{
+public:
+    explicit publisher(rcu_value& rv)
+      : rv_{rv}
+      , copy_{new node{rv.current_.load(std::memory_order_relaxed)->value_}}
+    {
+    }
+
+    publisher(publisher const&) = delete;
+    publisher& operator=(publisher const&) = delete;
+
+    ~publisher()
+    {
+        if (copy_)
+        {
+            auto old = rv_.current_.exchange(copy_.release(),
+                                             std::memory_order_seq_cst);
+            rv_.retire(old);
+            rv_.reclaim();
+        }
+    }
+
+    T& value() noexcept
+    {
+        return copy_->value_;
+    }
+
+    void cancel() noexcept
+    {
+        copy_.reset();
+    }
+
+private:
+    rcu_value& rv_;
+    std::unique_ptr<node> copy_;
+};
+
+template<typename T, typename Lockable>
+rcu_value<T, Lockable>::rcu_value()
+  : current_{new node{}}
+{
+}
+
+template<typename T, typename Lockable>
+template<typename Arg1, typename... Args>
+rcu_value<T, Lockable>::rcu_value(Arg1&& arg1, Args&&... args)
+  : current_{new node{std::forward<Arg1>(arg1), std::forward<Args>(args)...}}
+{
+}
+
+template<typename T, typename Lockable>
+rcu_value<T, Lockable>::~rcu_value()
+{
+    delete current_.load(std::memory_order_relaxed);
+    while (retired_ != nullptr)
+    {
+        delete detail::exchange(retired_, retired_->retired_next_);
+    }
+}
+
+template<typename T, typename Lockable>
+void
+rcu_value<T, Lockable>::retire(node* n) noexcept
+{
+    n->retired_next_ = retired_;
+    retired_ = n;
+}
+
+template<typename T, typename Lockable>
+void
+rcu_value<T, Lockable>::reclaim() noexcept
+{
+    auto next = &retired_;
+    while (*next != nullptr)
+    {
+        auto n = *next;
+        if (detail::hazard_domain::is_protected(n))
+        {
+            next = &n->retired_next_;
+            continue;
+        }
+
+        *next = n->retired_next_;
+        delete n;
+    }
+}
+
+template<typename Callable, typename U, typename L>
+auto
+apply(Callable&& f, rcu_value<U, L>& rv)
+  -> decltype(std::forward<Callable>(f)(std::declval<U&>()))
+{
+    std::lock_guard<L> guard{rv.mutex_};
+    typename rcu_value<U, L>::publisher p{rv};
+    try
+    {
+        return std::forward<Callable>(f)(p.value());
+    }
+    catch (...)
+    {
+        p.cancel();
+        throw;
+    }
+}
+
+template<typename Callable, typename... Ts, typename... Lockables>
+auto
+apply(Callable&& f, rcu_value<Ts, Lockables> const&... rvs)
+  -> decltype(std::forward<Callable>(f)(std::declval<Ts const&>()...))
+{
+    static_assert(sizeof...(Ts) <= detail::hazard_record::slot_count,
+                  "Too many values for a single apply()");
+
+    std::tuple<detail::hazard_ptr<typename rcu_value<Ts, Lockables>::node>...>
+      snapshots{rvs.current_...};
+    return boost::mp11::tuple_apply(
+      detail::invoke_with_hazards<Callable>{std::forward<Callable>(f)},
+      snapshots);
+}
+
+} // namespace netu
+
+#endif // NETU_IMPL_RCU_VALUE_HPP
@@ -0,0 +1,270 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_IMPL_SEQLOCK_HPP
+#define NETU_IMPL_SEQLOCK_HPP
+
+#include <netu/seqlock.hpp>
+
+#include <boost/mp11/tuple.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+namespace netu
+{
+
+inline void
+seqlock::lock() noexcept
+{
+    while (!try_lock())
+    {
+        std::this_thread::yield();
+    }
+}
+
+inline bool
+seqlock::try_lock() noexcept
+{
+    auto seq = seq_.load(std::memory_order_relaxed);
+    if ((seq & 1) != 0 ||
+        !seq_.compare_exchange_strong(
+          seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    // Writes to the protected data must not become visible before the odd
+    // sequence number.
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+}
+
+inline void
+seqlock::unlock() noexcept
+{
+    seq_.fetch_add(1, std::memory_order_release);
+}
+
+inline auto
+seqlock::read_begin() const noexcept -> sequence_type
+{
+    for (;;)
+    {
+        auto seq = seq_.load(std::memory_order_acquire);
+        if ((seq & 1) == 0)
+        {
+            return seq;
+        }
+        std::this_thread::yield();
+    }
+}
+
+inline bool
+seqlock::read_retry(sequence_type seq) const noexcept
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq_.load(std::memory_order_relaxed) != seq;
+}
+
+namespace detail
+{
+
+// Values protected by a seqlock are read while a writer may be modifying them,
+// so both sides access them through relaxed atomic operations on whole words
+// (or on bytes, if the value isn't made of whole words).
+template<typename T>
+using seqlock_word_t = typename std::conditional<
+  sizeof(T) % sizeof(std::uintptr_t) == 0 &&
+    alignof(T) % alignof(std::uintptr_t) == 0,
+  std::uintptr_t,
+  unsigned char>::type;
+
+template<typename T>
+void
+seqlock_load(void* dst, T const& src) noexcept
+{
+    using word = seqlock_word_t<T>;
+    static_assert(sizeof(std::atomic<word>) == sizeof(word) &&
+                    alignof(std::atomic<word>) == alignof(word),
+                  "std::atomic must have the layout of the underlying type");
+
+    auto const* from = reinterpret_cast<std::atomic<word> const*>(&src);
+    auto* to = static_cast<word*>(dst);
+    for (std::size_t i = 0; i < sizeof(T) / sizeof(word); ++i)
+    {
+        to[i] = from[i].load(std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+void
+seqlock_store(T& dst, void const* src) noexcept
+{
+    using word = seqlock_word_t<T>;
+    auto* to = reinterpret_cast<std::atomic<word>*>(&dst);
+    auto const* from = static_cast<word const*>(src);
+    for (std::size_t i = 0; i < sizeof(T) / sizeof(word); ++i)
+    {
+        to[i].store(from[i], std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+class seqlock_snapshot
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Values protected by a seqlock must be trivially copyable");
+
+public:
+    seqlock_snapshot(T const& value, seqlock const& sl) noexcept
+      : value_{value}
+      , seqlock_{sl}
+    {
+    }
+
+    void read() noexcept
+    {
+        seq_ = seqlock_.read_begin();
+        seqlock_load(&storage_, value_);
+    }
+
+    bool retry() const noexcept
+    {
+        return seqlock_.read_retry(seq_);
+    }
+
+    T const& get() const noexcept
+    {
+        return *reinterpret_cast<T const*>(&storage_);
+    }
+
+private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+    T const& value_;
+    seqlock const& seqlock_;
+    seqlock::sequence_type seq_ = 0;
+};
+
+// Copy of a value modified by a writer, which is published when the update
+// is destroyed, before the seqlock is unlocked.
+template<typename T>
+class seqlock_update
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Values protected by a seqlock must be trivially copyable");
+
+public:
+    explicit seqlock_update(T& value) noexcept
+      : value_{value}
+    {
+        // Other writers are locked out, so a plain read doesn't race
+        std::memcpy(&storage_, &value_, sizeof(T));
+    }
+
+    seqlock_update(seqlock_update const&) = delete;
+    seqlock_update& operator=(seqlock_update const&) = delete;
+
+    ~seqlock_update()
+    {
+        seqlock_store(value_, &storage_);
+    }
+
+    T& get() noexcept
+    {
+        return *reinterpret_cast<T*>(&storage_);
+    }
+
+private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+    T& value_;
+};
+
+struct read_snapshot
+{
+    template<typename T>
+    void operator()(seqlock_snapshot<T>& s) const noexcept
+    {
+        s.read();
+    }
+};
+
+struct retry_snapshot
+{
+    template<typename T>
+    void operator()(seqlock_snapshot<T> const& s) noexcept
+    {
+        retry = retry || s.retry();
+    }
+
+    bool& retry;
+};
+
+template<typename Callable>
+struct invoke_with_snapshots
+{
+    template<typename... Snapshots>
+    auto operator()(Snapshots&... ss)
+      -> decltype(std::declval<Callable>()(ss.get()...))
+    {
+        return std::forward<Callable>(f)(ss.get()...);
+    }
+
+    Callable&& f;
+};
+
+} // namespace detail
+
+template<typename Callable, typename... Ts, typename... Layouts>
+auto
+apply(Callable&& f, synchronized_value<Ts, seqlock, Layouts>&... svs)
+  -> decltype(std::forward<Callable>(f)(svs.value_...))
+{
+    static_assert(
+      !std::is_reference<decltype(std::forward<Callable>(f)(svs.value_...))>::
+        value,
+      "The callable modifies copies of the values, so it can't return "
+      "references to them");
+
+    detail::scoped_lock<decltype(svs.mutex_)...> guard{svs.mutex_...};
+    std::tuple<detail::seqlock_update<Ts>...> updates{svs.value_...};
+    return boost::mp11::tuple_apply(
+      detail::invoke_with_snapshots<Callable>{std::forward<Callable>(f)},
+      updates);
+}
+
+template<typename Callable, typename... Ts, typename... Layouts>
+auto
+apply(Callable&& f, synchronized_value<Ts, seqlock, Layouts> const&... svs)
+  -> decltype(std::forward<Callable>(f)(svs.value_...))
+{
+    std::tuple<detail::seqlock_snapshot<Ts>...> snapshots{
+      detail::seqlock_snapshot<Ts>{svs.value_, svs.mutex_}...};
+
+    // All snapshots are validated together, so that the callable observes
+    // the values as they were at a single point in time.
+    bool retry = false;
+    do
+    {
+        boost::mp11::tuple_for_each(snapshots, detail::read_snapshot{});
+        retry = false;
+        boost::mp11::tuple_for_each(snapshots, detail::retry_snapshot{retry});
+    } while (retry);
+
+    return boost::mp11::tuple_apply(
+      detail::invoke_with_snapshots<Callable>{std::forward<Callable>(f)},
+      snapshots);
+}
+
+} // namespace netu
+
+#endif // NETU_IMPL_SEQLOCK_HPP
@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_IMPL_SHARDED_VALUE_HPP
+#define NETU_IMPL_SHARDED_VALUE_HPP
+
+#include <netu/sharded_value.hpp>
+
+#include <netu/detail/thread_index.hpp>
+
+#include <boost/assert.hpp>
+
+namespace netu
+{
+
+namespace detail
+{
+
+template<typename Callable, typename Shards, std::size_t... Is>
+auto
+apply_shards(Callable&& f,
+             Shards const& shards,
+             boost::mp11::index_sequence<Is...>)
+  -> decltype(netu::apply(std::forward<Callable>(f), shards[Is]...))
+{
+    return netu::apply(std::forward<Callable>(f), shards[Is]...);
+}
+
+template<typename U, typename BinaryOperation>
+struct combine_shard
+{
+    template<typename T>
+    void operator()(T const& v)
+    {
+        acc = op(std::move(acc), v);
+    }
+
+    U& acc;
+    BinaryOperation& op;
+};
+
+} // namespace detail
+
+template<typename T, std::size_t N, typename Lockable>
+constexpr std::size_t sharded_value<T, N, Lockable>::shard_count;
+
+template<typename T, std::size_t N, typename Lockable>
+template<typename U, typename BinaryOperation>
+U
+sharded_value<T, N, Lockable>::combine(U init, BinaryOperation op) const
+{
+    for (auto const& s : shards_)
+    {
+        netu::apply(detail::combine_shard<U, BinaryOperation>{init, op},
+                    s);
+    }
+    return init;
+}
+
+template<typename T, std::size_t N, typename Lockable>
+auto
+sharded_value<T, N, Lockable>::shard(std::size_t i) noexcept -> shard_type&
+{
+    BOOST_ASSERT(i < N);
+    return shards_[i];
+}
+
+template<typename T, std::size_t N, typename Lockable>
+auto
+sharded_value<T, N, Lockable>::shard(std::size_t i) const noexcept
+  -> shard_type const&
+{
+    BOOST_ASSERT(i < N);
+    return shards_[i];
+}
+
+template<typename T, std::size_t N, typename Lockable>
+auto
+sharded_value<T, N, Lockable>::local_shard() noexcept -> shard_type&
+{
+    return shards_[detail::this_thread_index() % N];
+}
+
+template<typename Callable, typename U, std::size_t M, typename L>
+auto
+apply(Callable&& f, sharded_value<U, M, L>& sv)
+  -> decltype(std::forward<Callable>(f)(std::declval<U&>()))
+{
+    return netu::apply(std::forward<Callable>(f), sv.local_shard());
+}
+
+template<typename Callable, typename U, std::size_t M, typename L>
+auto
+apply(Callable&& f, sharded_value<U, M, L> const& sv)
+  -> decltype(detail::apply_shards(std::forward<Callable>(f),
+                                   sv.shards_,
+                                   boost::mp11::make_index_sequence<M>{}))
+{
+    return detail::apply_shards(std::forward<Callable>(f),
+                                sv.shards_,
+                                boost::mp11::make_index_sequence<M>{});
+}
+
+} // namespace netu
+
+#endif // NETU_IMPL_SHARDED_VALUE_HPP
@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_IMPL_SYNCHRONIZED_ARRAY_HPP
+#define NETU_IMPL_SYNCHRONIZED_ARRAY_HPP
+
+#include <netu/synchronized_array.hpp>
+
+#include <boost/assert.hpp>
+
+namespace netu
+{
+
+template<typename T, std::size_t N, typename Lockable, typename Layout>
+auto
+synchronized_array<T, N, Lockable, Layout>::operator[](size_type i) noexcept
+  -> reference
+{
+    BOOST_ASSERT(i < N);
+    return elements_[i];
+}
+
+template<typename T, std::size_t N, typename Lockable, typename Layout>
+auto
+synchronized_array<T, N, Lockable, Layout>::
+operator[](size_type i) const noexcept -> const_reference
+{
+    BOOST_ASSERT(i < N);
+    return elements_[i];
+}
+
+template<typename T, std::size_t N, typename Lockable, typename Layout>
+constexpr auto
+synchronized_array<T, N, Lockable, Layout>::size() noexcept -> size_type
+{
+    return N;
+}
+
+template<typename T, std::size_t N, typename Lockable, typename Layout>
+auto
+synchronized_array<T, N, Lockable, Layout>::begin() noexcept -> iterator
+{
+    return elements_.begin();
+}
+
+template<typename T, std::size_t N, typename Lockable, typename Layout>
+auto
+synchronized_array<T, N, Lockable, Layout>::begin() const noexcept
+  -> const_iterator
+{
+    return elements_.begin();
+}
+
+template<typename T, std::size_t N, typename Lockable, typename Layout>
+auto
+synchronized_array<T, N, Lockable, Layout>::end() noexcept -> iterator
+{
+    return elements_.end();
+}
+
+template<typename T, std::size_t N, typename Lockable, typename Layout>
+auto
+synchronized_array<T, N, Lockable, Layout>::end() const noexcept
+  -> const_iterator
+{
+    return elements_.end();
+}
+
+} // namespace netu
+
+#endif // NETU_IMPL_SYNCHRONIZED_ARRAY_HPP
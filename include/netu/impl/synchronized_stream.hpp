@@ -9,57 +9,81 @@
 
 #include <netu/synchronized_stream.hpp>
 
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/system/system_error.hpp>
+
 namespace netu
 {
-template<typename NextLayer, typename Executor>
+template<typename NextLayer, typename Executor, typename WriteExecutor>
 template<typename... StreamArgs, typename... ExecutorArgs>
-synchronized_stream<NextLayer, Executor>::synchronized_stream(
+synchronized_stream<NextLayer, Executor, WriteExecutor>::synchronized_stream(
   std::piecewise_construct_t,
   std::tuple<StreamArgs...> sa,
   std::tuple<ExecutorArgs...> ea)
   : p_(std::piecewise_construct, std::move(sa), std::move(ea))
 {
 }
-template<typename NextLayer, typename Executor>
+template<typename NextLayer, typename Executor, typename WriteExecutor>
 template<typename StreamArg, typename ExecutorArg>
-synchronized_stream<NextLayer, Executor>::synchronized_stream(StreamArg&& sa,
-                                                              ExecutorArg&& ea)
+synchronized_stream<NextLayer, Executor, WriteExecutor>::synchronized_stream(
+  StreamArg&& sa,
+  ExecutorArg&& ea)
   : p_{std::forward<StreamArg>(sa), std::forward<ExecutorArg>(ea)}
 {
 }
-template<typename NextLayer, typename Executor>
-synchronized_stream<NextLayer, Executor>::synchronized_stream(
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+template<typename StreamArg, typename ExecutorArg, typename WriteExecutorArg>
+synchronized_stream<NextLayer, Executor, WriteExecutor>::synchronized_stream(
+  StreamArg&& sa,
+  ExecutorArg&& ea,
+  WriteExecutorArg&& wea)
+  : p_{std::forward<StreamArg>(sa), std::forward<ExecutorArg>(ea)}
+  , write_executor_{std::forward<WriteExecutorArg>(wea)}
+{
+}
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+synchronized_stream<NextLayer, Executor, WriteExecutor>::synchronized_stream(
   boost::asio::io_context& ctx)
   : p_{ctx, ctx.get_executor()}
 {
 }
 
-template<typename NextLayer, typename Executor>
-template<typename CompletionHandler>
-class synchronized_stream<NextLayer, Executor>::io_op
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+template<typename CompletionHandler, typename IoExecutor>
+class synchronized_stream<NextLayer, Executor, WriteExecutor>::io_op
 {
+    using uses_default_allocator = detail::allocators::is_std_allocator<
+      boost::asio::associated_allocator_t<CompletionHandler>>;
+
 public:
-    using executor_type = typename synchronized_stream::executor_type;
-    using allocator_type =
-      boost::asio::associated_allocator_t<CompletionHandler>;
+    using executor_type = IoExecutor;
+    using allocator_type = typename std::conditional<
+      uses_default_allocator::value,
+      detail::allocators::slot_allocator<void>,
+      boost::asio::associated_allocator_t<CompletionHandler>>::type;
 
     static_assert(!detail::has_executor<CompletionHandler>::value,
                   "CompletionHandler has an associated Executor.");
 
-    io_op(synchronized_stream& s, CompletionHandler&& h)
-      : stream_{s}
+    io_op(IoExecutor const& ex,
+          detail::allocators::recycling_slot& slot,
+          CompletionHandler&& h)
+      : ex_{ex}
+      , slot_{slot}
       , handler_{std::move(h)}
     {
     }
 
     executor_type get_executor() const noexcept
     {
-        return stream_.get_executor();
+        return ex_;
     }
 
     allocator_type get_allocator() const noexcept
     {
-        return boost::asio::get_associated_allocator(handler_);
+        return get_allocator(uses_default_allocator{});
     }
 
     template<typename... Args>
@@ -69,39 +93,406 @@ public:
     }
 
 private:
-    synchronized_stream& stream_;
+    allocator_type get_allocator(std::true_type) const noexcept
+    {
+        return allocator_type{slot_};
+    }
+
+    allocator_type get_allocator(std::false_type) const noexcept
+    {
+        return boost::asio::get_associated_allocator(handler_);
+    }
+
+    IoExecutor const& ex_;
+    detail::allocators::recycling_slot& slot_;
     CompletionHandler handler_;
 };
 
-template<typename NextLayer, typename Executor>
+// Writes the buffers gathered from the write queue until it is empty
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+class synchronized_stream<NextLayer, Executor, WriteExecutor>::flush_op
+{
+public:
+    using executor_type = typename synchronized_stream::write_executor_type;
+    using allocator_type = detail::allocators::slot_allocator<void>;
+
+    explicit flush_op(synchronized_stream& s)
+      : stream_{s}
+    {
+    }
+
+    executor_type get_executor() const noexcept
+    {
+        return stream_.write_executor_;
+    }
+
+    allocator_type get_allocator() const noexcept
+    {
+        return allocator_type{*stream_.write_slot_};
+    }
+
+    void operator()()
+    {
+        auto& s = stream_;
+        s.next_layer().async_write_some(s.write_queue_->prepare(),
+                                        std::move(*this));
+    }
+
+    void operator()(boost::system::error_code ec, std::size_t n)
+    {
+        auto& s = stream_;
+        deferred_io_batch finished;
+        auto const more = s.write_queue_->consume(ec, n, finished);
+
+        // The next write is only started after the handlers have returned, so
+        // that they complete in order even if the write executor isn't a
+        // strand. A throwing handler must not stall the queue, though.
+        try
+        {
+            complete_op{s, std::move(finished)}();
+        }
+        catch (...)
+        {
+            if (more)
+            {
+                (*this)();
+            }
+            throw;
+        }
+
+        if (more)
+        {
+            (*this)();
+        }
+    }
+
+private:
+    synchronized_stream& stream_;
+};
+
+// Invokes the handlers of finished writes. If one of them throws, the
+// remaining ones are invoked by another complete_op posted to the write
+// executor.
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+class synchronized_stream<NextLayer, Executor, WriteExecutor>::complete_op
+{
+public:
+    using executor_type = typename synchronized_stream::write_executor_type;
+
+    complete_op(synchronized_stream& s, deferred_io_batch&& finished)
+      : stream_{s}
+      , finished_{std::move(finished)}
+    {
+    }
+
+    executor_type get_executor() const noexcept
+    {
+        return stream_.write_executor_;
+    }
+
+    void operator()()
+    {
+        try
+        {
+            finished_.invoke();
+        }
+        catch (...)
+        {
+            if (!finished_.empty())
+            {
+                auto& s = stream_;
+                boost::asio::post(s.write_executor_, std::move(*this));
+            }
+            throw;
+        }
+    }
+
+private:
+    synchronized_stream& stream_;
+    deferred_io_batch finished_;
+};
+
+// Invokes an operation's handler with the result of a speculative read or
+// write
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+template<typename Handler>
+class synchronized_stream<NextLayer, Executor, WriteExecutor>::speculative_op
+{
+public:
+    using executor_type = boost::asio::associated_executor_t<Handler>;
+    using allocator_type = boost::asio::associated_allocator_t<Handler>;
+
+    speculative_op(Handler&& h, boost::system::error_code ec, std::size_t n)
+      : handler_{std::move(h)}
+      , ec_{ec}
+      , n_{n}
+    {
+    }
+
+    executor_type get_executor() const noexcept
+    {
+        return boost::asio::get_associated_executor(handler_);
+    }
+
+    allocator_type get_allocator() const noexcept
+    {
+        return boost::asio::get_associated_allocator(handler_);
+    }
+
+    void operator()()
+    {
+        handler_(ec_, n_);
+    }
+
+private:
+    Handler handler_;
+    boost::system::error_code ec_;
+    std::size_t n_;
+};
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+template<typename MutableBuffers>
+std::size_t
+synchronized_stream<NextLayer, Executor, WriteExecutor>::read_some(
+  MutableBuffers const& b)
+{
+    boost::system::error_code ec;
+    auto const n = read_some(b, ec);
+    if (ec)
+    {
+        throw boost::system::system_error{ec};
+    }
+    return n;
+}
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+template<typename MutableBuffers>
+std::size_t
+synchronized_stream<NextLayer, Executor, WriteExecutor>::read_some(
+  MutableBuffers const& b,
+  boost::system::error_code& ec)
+{
+    return next_layer().read_some(b, ec);
+}
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+template<typename ConstBuffers>
+std::size_t
+synchronized_stream<NextLayer, Executor, WriteExecutor>::write_some(
+  ConstBuffers const& b)
+{
+    boost::system::error_code ec;
+    auto const n = write_some(b, ec);
+    if (ec)
+    {
+        throw boost::system::system_error{ec};
+    }
+    return n;
+}
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+template<typename ConstBuffers>
+std::size_t
+synchronized_stream<NextLayer, Executor, WriteExecutor>::write_some(
+  ConstBuffers const& b,
+  boost::system::error_code& ec)
+{
+    return next_layer().write_some(b, ec);
+}
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+void
+synchronized_stream<NextLayer, Executor, WriteExecutor>::non_blocking(
+  bool mode)
+{
+    boost::system::error_code ec;
+    non_blocking(mode, ec);
+    if (ec)
+    {
+        throw boost::system::system_error{ec};
+    }
+}
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+void
+synchronized_stream<NextLayer, Executor, WriteExecutor>::non_blocking(
+  bool mode,
+  boost::system::error_code& ec)
+{
+    lowest_layer().non_blocking(mode, ec);
+    if (!ec)
+    {
+        non_blocking_ = mode;
+        speculative_io_ = speculative_io_ && mode;
+    }
+}
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+void
+synchronized_stream<NextLayer, Executor, WriteExecutor>::set_speculative_io(
+  bool enabled)
+{
+    boost::system::error_code ec;
+    set_speculative_io(enabled, ec);
+    if (ec)
+    {
+        throw boost::system::system_error{ec};
+    }
+}
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+void
+synchronized_stream<NextLayer, Executor, WriteExecutor>::set_speculative_io(
+  bool enabled,
+  boost::system::error_code& ec)
+{
+    static_assert(supports_speculative_io::value,
+                  "Speculative I/O requires the next layer to be the lowest "
+                  "layer.");
+
+    // Disabling speculative I/O restores the mode chosen by the user
+    lowest_layer().non_blocking(enabled || non_blocking_, ec);
+    if (!ec)
+    {
+        speculative_io_ = enabled;
+    }
+}
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+template<typename MutableBuffers>
+std::size_t
+synchronized_stream<NextLayer, Executor, WriteExecutor>::try_read_some(
+  MutableBuffers const& b,
+  boost::system::error_code& ec,
+  std::true_type)
+{
+    return next_layer().read_some(b, ec);
+}
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+template<typename MutableBuffers>
+std::size_t
+synchronized_stream<NextLayer, Executor, WriteExecutor>::try_read_some(
+  MutableBuffers const&,
+  boost::system::error_code& ec,
+  std::false_type)
+{
+    ec = boost::asio::error::would_block;
+    return 0;
+}
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+template<typename ConstBuffers>
+std::size_t
+synchronized_stream<NextLayer, Executor, WriteExecutor>::try_write_some(
+  ConstBuffers const& b,
+  boost::system::error_code& ec,
+  std::true_type)
+{
+    return next_layer().write_some(b, ec);
+}
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+template<typename ConstBuffers>
+std::size_t
+synchronized_stream<NextLayer, Executor, WriteExecutor>::try_write_some(
+  ConstBuffers const&,
+  boost::system::error_code& ec,
+  std::false_type)
+{
+    ec = boost::asio::error::would_block;
+    return 0;
+}
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+template<typename Handler>
+bool
+synchronized_stream<NextLayer, Executor, WriteExecutor>::complete_speculative(
+  Handler& h,
+  boost::system::error_code ec,
+  std::size_t n)
+{
+    if (ec == boost::asio::error::would_block ||
+        ec == boost::asio::error::try_again)
+    {
+        return false;
+    }
+
+    boost::asio::post(next_layer().get_executor(),
+                      speculative_op<Handler>{std::move(h), ec, n});
+    return true;
+}
+
+template<typename NextLayer, typename Executor, typename WriteExecutor>
 template<typename MutableBuffers, typename CompletionToken>
 auto
-synchronized_stream<NextLayer, Executor>::async_read_some(MutableBuffers&& b,
-                                                          CompletionToken&& tok)
-  -> detail::io_completion_result_t<CompletionToken>
+synchronized_stream<NextLayer, Executor, WriteExecutor>::async_read_some(
+  MutableBuffers&& b,
+  CompletionToken&& tok) -> detail::io_completion_result_t<CompletionToken>
 {
     detail::io_completion_t<CompletionToken> init{tok};
     using ch_t = typename decltype(init)::completion_handler_type;
 
-    io_op<ch_t> op{*this, std::move(init.completion_handler)};
+    io_op<ch_t, executor_type> op{
+      p_.second, *read_slot_, std::move(init.completion_handler)};
+    if (speculative_io_)
+    {
+        boost::system::error_code ec;
+        auto const n = try_read_some(b, ec, supports_speculative_io{});
+        if (complete_speculative(op, ec, n))
+        {
+            return init.result.get();
+        }
+    }
     next_layer().async_read_some(std::forward<MutableBuffers>(b),
                                  std::move(op));
     return init.result.get();
 }
 
-template<typename NextLayer, typename Executor>
+template<typename NextLayer, typename Executor, typename WriteExecutor>
 template<typename ConstBuffers, typename CompletionToken>
 auto
-synchronized_stream<NextLayer, Executor>::async_write_some(
+synchronized_stream<NextLayer, Executor, WriteExecutor>::async_write_some(
   ConstBuffers&& b,
   CompletionToken&& tok) -> detail::io_completion_result_t<CompletionToken>
 {
     detail::io_completion_t<CompletionToken> init{tok};
     using ch_t = typename decltype(init)::completion_handler_type;
 
-    io_op<ch_t> op{*this, std::move(init.completion_handler)};
+    io_op<ch_t, write_executor_type> op{
+      write_executor_, *write_slot_, std::move(init.completion_handler)};
+    if (speculative_io_)
+    {
+        boost::system::error_code ec;
+        auto const n = try_write_some(b, ec, supports_speculative_io{});
+        if (complete_speculative(op, ec, n))
+        {
+            return init.result.get();
+        }
+    }
     next_layer().async_write_some(std::forward<ConstBuffers>(b), std::move(op));
     return init.result.get();
 }
 
+template<typename NextLayer, typename Executor, typename WriteExecutor>
+template<typename ConstBuffers, typename CompletionToken>
+auto
+synchronized_stream<NextLayer, Executor, WriteExecutor>::async_write(
+  ConstBuffers const& b,
+  CompletionToken&& tok) -> detail::io_completion_result_t<CompletionToken>
+{
+    detail::io_completion_t<CompletionToken> init{tok};
+    using ch_t = typename decltype(init)::completion_handler_type;
+
+    // Queued handlers are invoked by flush_op on the write executor
+    static_assert(!detail::has_executor<ch_t>::value,
+                  "CompletionHandler has an associated Executor.");
+
+    if (write_queue_->push(b, std::move(init.completion_handler)))
+    {
+        boost::asio::dispatch(write_executor_, flush_op{*this});
+    }
+    return init.result.get();
+}
+
 } // namespace netu
@@ -12,6 +12,18 @@
 
 #include <netu/synchronized_value.hpp>
 
+#include <boost/mp11/algorithm.hpp>
+#include <boost/mp11/tuple.hpp>
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
 namespace netu
 {
 
@@ -61,26 +73,518 @@ private:
     std::tuple<detail::adopting_lock_guard<Lockables>...> guards_;
 };
 
+// Gives algorithms built on top of synchronized_value access to its members
+struct synchronized_value_access
+{
+    template<typename T, typename Lockable, typename Layout>
+    static T& value(synchronized_value<T, Lockable, Layout>& sv) noexcept
+    {
+        return sv.value_;
+    }
+
+    template<typename T, typename Lockable, typename Layout>
+    static Lockable& mutex(synchronized_value<T, Lockable, Layout>& sv) noexcept
+    {
+        return sv.mutex_;
+    }
+};
+
+template<typename...>
+struct make_void
+{
+    using type = void;
+};
+
+template<typename... Ts>
+using void_t = typename make_void<Ts...>::type;
+
+// Detects SharedLockable types, e.g. std::shared_mutex or boost::shared_mutex
+template<typename Lockable, typename = void>
+struct is_shared_lockable : std::false_type
+{
+};
+
+template<typename Lockable>
+struct is_shared_lockable<
+  Lockable,
+  void_t<decltype(std::declval<Lockable&>().lock_shared()),
+         decltype(std::declval<Lockable&>().try_lock_shared()),
+         decltype(std::declval<Lockable&>().unlock_shared())>>
+  : std::true_type
+{
+};
+
+// Presents shared ownership of a SharedLockable as a Lockable, so that it can
+// be passed to std::lock.
+template<typename SharedLockable>
+class shared_lockable_ref
+{
+public:
+    explicit shared_lockable_ref(SharedLockable& l) noexcept
+      : l_{l}
+    {
+    }
+
+    void lock()
+    {
+        l_.lock_shared();
+    }
+
+    bool try_lock()
+    {
+        return l_.try_lock_shared();
+    }
+
+    template<typename Clock, typename Duration>
+    bool try_lock_until(std::chrono::time_point<Clock, Duration> const& tp)
+    {
+        return l_.try_lock_shared_until(tp);
+    }
+
+    void unlock() noexcept
+    {
+        l_.unlock_shared();
+    }
+
+    SharedLockable& get() const noexcept
+    {
+        return l_;
+    }
+
+private:
+    SharedLockable& l_;
+};
+
+template<typename Lockable>
+using const_lockable_ref_t =
+  typename std::conditional<is_shared_lockable<Lockable>::value,
+                            shared_lockable_ref<Lockable>,
+                            Lockable&>::type;
+
+template<typename Lockable>
+void const*
+lockable_address(Lockable& l) noexcept
+{
+    return std::addressof(l);
+}
+
+template<typename SharedLockable>
+void const*
+lockable_address(shared_lockable_ref<SharedLockable>& l) noexcept
+{
+    return std::addressof(l.get());
+}
+
+struct ordered_lock_entry
+{
+    template<typename Lockable>
+    explicit ordered_lock_entry(Lockable& l) noexcept
+      : address_{detail::lockable_address(l)}
+      , lockable_{std::addressof(l)}
+      , lock_{[](void* p) { static_cast<Lockable*>(p)->lock(); }}
+      , unlock_{[](void* p) { static_cast<Lockable*>(p)->unlock(); }}
+    {
+    }
+
+    void const* address_;
+    void* lockable_;
+    void (*lock_)(void*);
+    void (*unlock_)(void*);
+};
+
+template<typename Lockable>
+void
+lock_ordered(Lockable& l)
+{
+    l.lock();
+}
+
+template<typename Lockable1, typename Lockable2, typename... Lockables>
+void
+lock_ordered(Lockable1& l1, Lockable2& l2, Lockables&... ls)
+{
+    std::array<ordered_lock_entry, 2 + sizeof...(Lockables)> entries{
+      {ordered_lock_entry{l1},
+       ordered_lock_entry{l2},
+       ordered_lock_entry{ls}...}};
+    std::sort(entries.begin(),
+              entries.end(),
+              [](ordered_lock_entry const& a, ordered_lock_entry const& b) {
+                  return std::less<void const*>{}(a.address_, b.address_);
+              });
+
+    std::size_t i = 0;
+    try
+    {
+        for (; i < entries.size(); ++i)
+        {
+            entries[i].lock_(entries[i].lockable_);
+        }
+    }
+    catch (...)
+    {
+        while (i > 0)
+        {
+            --i;
+            entries[i].unlock_(entries[i].lockable_);
+        }
+        throw;
+    }
+}
+
+struct unlock_one
+{
+    template<typename Lockable>
+    void operator()(Lockable& l) const noexcept
+    {
+        l.unlock();
+    }
+};
+
+// Acquires the Lockables referred to by Refs using LockPolicy
+template<typename LockPolicy, typename... Refs>
+class basic_scoped_lock
+{
+public:
+    template<typename... Lockables>
+    explicit basic_scoped_lock(LockPolicy const& policy, Lockables&... ls)
+      : refs_{ls...}
+    {
+        boost::mp11::tuple_apply(policy, refs_);
+    }
+
+    basic_scoped_lock(basic_scoped_lock const&) = delete;
+    basic_scoped_lock& operator=(basic_scoped_lock const&) = delete;
+
+    ~basic_scoped_lock()
+    {
+        boost::mp11::tuple_for_each(refs_, unlock_one{});
+    }
+
+private:
+    std::tuple<Refs...> refs_;
+};
+
+// Locks each Lockable in shared mode if it supports it and in exclusive mode
+// otherwise.
+template<typename LockPolicy, typename... Lockables>
+using const_scoped_lock =
+  basic_scoped_lock<LockPolicy, const_lockable_ref_t<Lockables>...>;
+
+template<typename Lockable>
+bool
+try_lock(Lockable& l)
+{
+    return l.try_lock();
+}
+
+template<typename Lockable1, typename Lockable2, typename... Lockables>
+bool
+try_lock(Lockable1& l1, Lockable2& l2, Lockables&... ls)
+{
+    return std::try_lock(l1, l2, ls...) == -1;
+}
+
+template<typename Clock, typename Duration, typename Lockable>
+bool
+try_lock_until(std::chrono::time_point<Clock, Duration> const& deadline,
+               Lockable& l)
+{
+    return l.try_lock_until(deadline);
+}
+
+// Waits for the first Lockable until deadline and only tries the remaining
+// ones, so that a thread never blocks while holding a lock. Backs off and
+// retries until deadline if any of them is busy.
+template<typename Clock,
+         typename Duration,
+         typename Lockable1,
+         typename Lockable2,
+         typename... Lockables>
+bool
+try_lock_until(std::chrono::time_point<Clock, Duration> const& deadline,
+               Lockable1& l1,
+               Lockable2& l2,
+               Lockables&... ls)
+{
+    while (l1.try_lock_until(deadline))
+    {
+        if (detail::try_lock(l2, ls...))
+        {
+            return true;
+        }
+
+        l1.unlock();
+        if (Clock::now() >= deadline)
+        {
+            break;
+        }
+        std::this_thread::yield();
+    }
+    return false;
+}
+
+struct try_lock_all
+{
+    template<typename... Lockables>
+    bool operator()(Lockables&... ls) const
+    {
+        return detail::try_lock(ls...);
+    }
+};
+
+template<typename Clock, typename Duration>
+struct try_lock_all_until
+{
+    template<typename... Lockables>
+    bool operator()(Lockables&... ls) const
+    {
+        return detail::try_lock_until(deadline, ls...);
+    }
+
+    std::chrono::time_point<Clock, Duration> const& deadline;
+};
+
+// Acquires either all of the Lockables referred to by Refs or none of them
+template<typename... Refs>
+class basic_try_lock
+{
+public:
+    template<typename... Lockables>
+    explicit basic_try_lock(std::try_to_lock_t, Lockables&... ls)
+      : refs_{ls...}
+      , owns_{boost::mp11::tuple_apply(try_lock_all{}, refs_)}
+    {
+    }
+
+    template<typename Clock, typename Duration, typename... Lockables>
+    basic_try_lock(std::chrono::time_point<Clock, Duration> const& deadline,
+                   Lockables&... ls)
+      : refs_{ls...}
+      , owns_{boost::mp11::tuple_apply(
+          try_lock_all_until<Clock, Duration>{deadline}, refs_)}
+    {
+    }
+
+    basic_try_lock(basic_try_lock const&) = delete;
+    basic_try_lock& operator=(basic_try_lock const&) = delete;
+
+    ~basic_try_lock()
+    {
+        if (owns_)
+        {
+            boost::mp11::tuple_for_each(refs_, unlock_one{});
+        }
+    }
+
+    bool owns_lock() const noexcept
+    {
+        return owns_;
+    }
+
+private:
+    std::tuple<Refs...> refs_;
+    bool owns_;
+};
+
+template<typename... Lockables>
+using const_try_lock = basic_try_lock<const_lockable_ref_t<Lockables>...>;
+
+// Values protected by a seqlock are read concurrently with their writers, so
+// they can only be modified by the seqlock overload of apply().
+template<typename... Lockables>
+using has_seqlock =
+  boost::mp11::mp_contains<boost::mp11::mp_list<Lockables...>, seqlock>;
+
+template<typename R>
+struct try_apply_result
+{
+    using type = boost::optional<R>;
+
+    template<typename Guard, typename Callable, typename... Args>
+    static type invoke(Guard const& g, Callable&& f, Args&... args)
+    {
+        if (!g.owns_lock())
+        {
+            return boost::none;
+        }
+        return type{std::forward<Callable>(f)(args...)};
+    }
+};
+
+template<>
+struct try_apply_result<void>
+{
+    using type = bool;
+
+    template<typename Guard, typename Callable, typename... Args>
+    static type invoke(Guard const& g, Callable&& f, Args&... args)
+    {
+        if (!g.owns_lock())
+        {
+            return false;
+        }
+        std::forward<Callable>(f)(args...);
+        return true;
+    }
+};
+
 } // namespace detail
 
-template<typename Callable, typename... Ts, typename... Lockables>
+template<typename... Lockables>
+void
+std_lock_policy::operator()(Lockables&... ls) const
+{
+    detail::lock(ls...);
+}
+
+template<typename... Lockables>
+void
+ordered_lock_policy::operator()(Lockables&... ls) const
+{
+    detail::lock_ordered(ls...);
+}
+
+template<typename Callable,
+         typename... Ts,
+         typename... Lockables,
+         typename... Layouts>
 auto
-apply(Callable&& f, synchronized_value<Ts, Lockables>&... svs)
+apply(Callable&& f, synchronized_value<Ts, Lockables, Layouts>&... svs)
   -> decltype(std::forward<Callable>(f)(svs.value_...))
 {
+    static_assert(!detail::has_seqlock<Lockables...>::value,
+                  "Values protected by a seqlock can only be modified by "
+                  "apply(f, svs...) over seqlock-protected values");
     detail::scoped_lock<Lockables...> guard{svs.mutex_...};
     return std::forward<Callable>(f)(svs.value_...);
 }
 
-template<typename Callable, typename... Ts, typename... Lockables>
+template<typename Callable,
+         typename... Ts,
+         typename... Lockables,
+         typename... Layouts>
 auto
-apply(Callable&& f, synchronized_value<Ts, Lockables> const&... svs)
+apply(Callable&& f, synchronized_value<Ts, Lockables, Layouts> const&... svs)
   -> decltype(std::forward<Callable>(f)(svs.value_...))
 {
-    detail::scoped_lock<Lockables...> guard{svs.mutex_...};
+    detail::const_scoped_lock<std_lock_policy, Lockables...> guard{
+      std_lock_policy{}, svs.mutex_...};
     return std::forward<Callable>(f)(svs.value_...);
 }
 
+template<typename LockPolicy,
+         typename Callable,
+         typename... Ts,
+         typename... Lockables,
+         typename... Layouts>
+auto
+apply(LockPolicy const& policy,
+      Callable&& f,
+      synchronized_value<Ts, Lockables, Layouts>&... svs)
+  -> decltype(std::forward<Callable>(f)(svs.value_...))
+{
+    static_assert(!detail::has_seqlock<Lockables...>::value,
+                  "Values protected by a seqlock can only be modified by "
+                  "apply(f, svs...) over seqlock-protected values");
+    detail::basic_scoped_lock<LockPolicy, Lockables&...> guard{policy,
+                                                              svs.mutex_...};
+    return std::forward<Callable>(f)(svs.value_...);
+}
+
+template<typename LockPolicy,
+         typename Callable,
+         typename... Ts,
+         typename... Lockables,
+         typename... Layouts>
+auto
+apply(LockPolicy const& policy,
+      Callable&& f,
+      synchronized_value<Ts, Lockables, Layouts> const&... svs)
+  -> decltype(std::forward<Callable>(f)(svs.value_...))
+{
+    detail::const_scoped_lock<LockPolicy, Lockables...> guard{policy,
+                                                             svs.mutex_...};
+    return std::forward<Callable>(f)(svs.value_...);
+}
+
+template<typename Callable,
+         typename... Ts,
+         typename... Lockables,
+         typename... Layouts>
+auto
+try_apply(Callable&& f, synchronized_value<Ts, Lockables, Layouts>&... svs)
+  -> detail::try_apply_result_t<decltype(
+    std::forward<Callable>(f)(svs.value_...))>
+{
+    static_assert(!detail::has_seqlock<Lockables...>::value,
+                  "Values protected by a seqlock can only be modified by "
+                  "apply(f, svs...) over seqlock-protected values");
+    using result_type = decltype(std::forward<Callable>(f)(svs.value_...));
+    detail::basic_try_lock<Lockables&...> guard{std::try_to_lock,
+                                                svs.mutex_...};
+    return detail::try_apply_result<result_type>::invoke(
+      guard, std::forward<Callable>(f), svs.value_...);
+}
+
+template<typename Callable,
+         typename... Ts,
+         typename... Lockables,
+         typename... Layouts>
+auto
+try_apply(Callable&& f,
+          synchronized_value<Ts, Lockables, Layouts> const&... svs)
+  -> detail::try_apply_result_t<decltype(
+    std::forward<Callable>(f)(svs.value_...))>
+{
+    using result_type = decltype(std::forward<Callable>(f)(svs.value_...));
+    detail::const_try_lock<Lockables...> guard{std::try_to_lock,
+                                               svs.mutex_...};
+    return detail::try_apply_result<result_type>::invoke(
+      guard, std::forward<Callable>(f), svs.value_...);
+}
+
+template<typename Clock,
+         typename Duration,
+         typename Callable,
+         typename... Ts,
+         typename... Lockables,
+         typename... Layouts>
+auto
+apply_until(std::chrono::time_point<Clock, Duration> const& deadline,
+            Callable&& f,
+            synchronized_value<Ts, Lockables, Layouts>&... svs)
+  -> detail::try_apply_result_t<decltype(
+    std::forward<Callable>(f)(svs.value_...))>
+{
+    static_assert(!detail::has_seqlock<Lockables...>::value,
+                  "Values protected by a seqlock can only be modified by "
+                  "apply(f, svs...) over seqlock-protected values");
+    using result_type = decltype(std::forward<Callable>(f)(svs.value_...));
+    detail::basic_try_lock<Lockables&...> guard{deadline, svs.mutex_...};
+    return detail::try_apply_result<result_type>::invoke(
+      guard, std::forward<Callable>(f), svs.value_...);
+}
+
+template<typename Clock,
+         typename Duration,
+         typename Callable,
+         typename... Ts,
+         typename... Lockables,
+         typename... Layouts>
+auto
+apply_until(std::chrono::time_point<Clock, Duration> const& deadline,
+            Callable&& f,
+            synchronized_value<Ts, Lockables, Layouts> const&... svs)
+  -> detail::try_apply_result_t<decltype(
+    std::forward<Callable>(f)(svs.value_...))>
+{
+    using result_type = decltype(std::forward<Callable>(f)(svs.value_...));
+    detail::const_try_lock<Lockables...> guard{deadline, svs.mutex_...};
+    return detail::try_apply_result<result_type>::invoke(
+      guard, std::forward<Callable>(f), svs.value_...);
+}
+
 } // namespace netu
 
 #endif // NETU_SYNCHRONIZED_VALUE_HPP
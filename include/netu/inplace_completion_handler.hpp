@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_INPLACE_COMPLETION_HANDLER_HPP
+#define NETU_INPLACE_COMPLETION_HANDLER_HPP
+
+#include <netu/completion_handler.hpp>
+
+namespace netu
+{
+
+// A completion_handler which never allocates. Constructing it from a handler
+// which does not fit into Capacity bytes, or which may throw when moved, is a
+// compile-time error.
+template<typename Signature,
+         std::size_t Capacity = detail::default_handler_capacity,
+         std::size_t Alignment = detail::default_handler_alignment>
+class inplace_completion_handler
+  : private completion_handler<Signature, Capacity, Alignment>
+{
+    using base_type = completion_handler<Signature, Capacity, Alignment>;
+
+public:
+    using typename base_type::allocator_type;
+
+    inplace_completion_handler() = default;
+
+    inplace_completion_handler(std::nullptr_t) noexcept;
+
+    inplace_completion_handler(inplace_completion_handler const&) = delete;
+    inplace_completion_handler(inplace_completion_handler&&) = default;
+
+    template<
+      typename Handler,
+      class = detail::disable_conversion_t<Handler, inplace_completion_handler>>
+    inplace_completion_handler(Handler&& handler) noexcept(
+      std::is_nothrow_constructible<detail::remove_cv_ref_t<Handler>,
+                                    Handler&&>::value);
+
+    inplace_completion_handler& operator=(inplace_completion_handler&&) =
+      default;
+
+    inplace_completion_handler& operator=(inplace_completion_handler const&) =
+      delete;
+
+    template<
+      typename Handler,
+      class = detail::disable_conversion_t<Handler, inplace_completion_handler>>
+    inplace_completion_handler& operator=(Handler&& handler) noexcept(
+      std::is_nothrow_constructible<detail::remove_cv_ref_t<Handler>,
+                                    Handler&&>::value);
+
+    inplace_completion_handler& operator=(std::nullptr_t) noexcept;
+
+    void swap(inplace_completion_handler& other) noexcept;
+
+    using base_type::invoke;
+    using base_type::operator();
+    using base_type::operator bool;
+    using base_type::get_allocator;
+    using base_type::get_executor;
+
+    template<typename S, std::size_t C, std::size_t A>
+    friend bool operator==(inplace_completion_handler<S, C, A> const& lhs,
+                           std::nullptr_t) noexcept;
+
+    template<typename S, std::size_t C, std::size_t A>
+    friend bool
+    operator==(std::nullptr_t lhs,
+               inplace_completion_handler<S, C, A> const& rhs) noexcept;
+
+    template<typename S, std::size_t C, std::size_t A>
+    friend bool operator!=(inplace_completion_handler<S, C, A> const& lhs,
+                           std::nullptr_t rhs) noexcept;
+
+    template<typename S, std::size_t C, std::size_t A>
+    friend bool
+    operator!=(std::nullptr_t lhs,
+               inplace_completion_handler<S, C, A> const& rhs) noexcept;
+};
+
+} // namespace netu
+
+namespace boost
+{
+namespace asio
+{
+
+template<typename Signature,
+         std::size_t Capacity,
+         std::size_t Alignment,
+         typename Executor>
+struct associated_executor<
+  netu::inplace_completion_handler<Signature, Capacity, Alignment>,
+  Executor>
+{
+    using type = netu::detail::erased_executor<Executor>;
+
+    static type get(
+      netu::inplace_completion_handler<Signature, Capacity, Alignment> const& h,
+      Executor const& ex = Executor())
+    {
+        return h.get_executor(ex);
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#include <netu/impl/inplace_completion_handler.hpp>
+
+#endif // NETU_INPLACE_COMPLETION_HANDLER_HPP
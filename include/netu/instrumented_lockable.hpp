@@ -0,0 +1,222 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_INSTRUMENTED_LOCKABLE_HPP
+#define NETU_INSTRUMENTED_LOCKABLE_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace netu
+{
+
+// Contention statistics of a single lock. Durations are recorded in
+// histograms with power of 2 buckets: bucket 0 holds durations below 1ns and
+// bucket i durations in [2^(i-1), 2^i) ns. The last bucket also holds all
+// longer durations.
+class lock_stats
+{
+public:
+    static constexpr std::size_t bucket_count = 32;
+
+    using duration_type = std::chrono::nanoseconds;
+    using histogram_type = std::array<std::uint64_t, bucket_count>;
+
+    explicit lock_stats(std::string name);
+
+    lock_stats(lock_stats const&) = delete;
+    lock_stats& operator=(lock_stats const&) = delete;
+
+    std::string const& name() const noexcept;
+
+    std::uint64_t acquisitions() const noexcept;
+
+    // Number of acquisitions which had to wait for another owner
+    std::uint64_t contentions() const noexcept;
+
+    histogram_type wait_histogram() const noexcept;
+
+    histogram_type hold_histogram() const noexcept;
+
+    void record_acquisition(bool contended, duration_type wait) noexcept;
+
+    void record_hold(duration_type hold) noexcept;
+
+    static std::size_t bucket(duration_type d) noexcept;
+
+    // Returns the upper bound of the bucket containing the p-th percentile
+    static duration_type percentile(histogram_type const& h, unsigned p);
+
+private:
+    using atomic_histogram_type =
+      std::array<std::atomic<std::uint64_t>, bucket_count>;
+
+    static histogram_type load(atomic_histogram_type const& h) noexcept;
+
+    std::string name_;
+    std::atomic<std::uint64_t> acquisitions_{0};
+    std::atomic<std::uint64_t> contentions_{0};
+    atomic_histogram_type wait_{};
+    atomic_histogram_type hold_{};
+};
+
+// Process-wide registry of the statistics of all live instrumented locks
+class lock_registry
+{
+public:
+    static lock_registry& instance();
+
+    lock_registry(lock_registry const&) = delete;
+    lock_registry& operator=(lock_registry const&) = delete;
+
+    void add(lock_stats const& s);
+
+    void remove(lock_stats const& s) noexcept;
+
+    // Invokes f with every registered lock_stats. Locks must not be created or
+    // destroyed by f.
+    template<typename Callable>
+    void for_each(Callable&& f) const;
+
+    // Writes one line of statistics per registered lock
+    void dump(std::ostream& os) const;
+
+private:
+    lock_registry() = default;
+
+    mutable std::mutex mutex_;
+    std::vector<lock_stats const*> stats_;
+};
+
+namespace detail
+{
+
+template<typename Lockable, typename = void>
+struct has_try_lock : std::false_type
+{
+};
+
+template<typename Lockable>
+struct has_try_lock<Lockable,
+                    decltype(void(std::declval<Lockable&>().try_lock()))>
+  : std::true_type
+{
+};
+
+} // namespace detail
+
+#if defined(NETU_DISABLE_LOCK_INSTRUMENTATION)
+
+// Instrumentation is disabled: a plain Lockable with the interface of the
+// wrapped Lockable and no overhead. The name is ignored and nothing is
+// registered.
+template<typename Lockable>
+class instrumented_lockable : public Lockable
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+    using lockable_type = Lockable;
+
+    static constexpr bool enabled = false;
+
+    instrumented_lockable() = default;
+
+    explicit instrumented_lockable(std::string const& name);
+
+    // Returns empty statistics, which aren't registered
+    static lock_stats const& stats() noexcept;
+};
+
+#else
+
+// Lockable wrapper which records contention statistics of the wrapped
+// BasicLockable, e.g. synchronized_value<T, instrumented_lockable<std::mutex>>.
+// The wrapper only provides the operations supported by the wrapped type.
+// Contentions can only be detected if it provides try_lock, otherwise only
+// wait times are recorded.
+//
+// Defining NETU_DISABLE_LOCK_INSTRUMENTATION turns it into a plain
+// pass-through, which records and registers nothing.
+template<typename Lockable>
+class instrumented_lockable
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+    using lockable_type = Lockable;
+
+    static constexpr bool enabled = true;
+
+    instrumented_lockable();
+
+    explicit instrumented_lockable(std::string name);
+
+    instrumented_lockable(instrumented_lockable const&) = delete;
+    instrumented_lockable& operator=(instrumented_lockable const&) = delete;
+
+    ~instrumented_lockable();
+
+    void lock();
+
+    template<typename L = Lockable>
+    auto try_lock() -> decltype(std::declval<L&>().try_lock());
+
+    template<typename Clock, typename Duration, typename L = Lockable>
+    auto try_lock_until(std::chrono::time_point<Clock, Duration> const& tp)
+      -> decltype(std::declval<L&>().try_lock_until(tp));
+
+    void unlock();
+
+    // Shared ownership is only available if Lockable supports it. Only wait
+    // times are recorded for shared owners.
+    template<typename L = Lockable>
+    auto lock_shared() -> decltype(std::declval<L&>().lock_shared());
+
+    template<typename L = Lockable>
+    auto try_lock_shared() -> decltype(std::declval<L&>().try_lock_shared());
+
+    template<typename Clock, typename Duration, typename L = Lockable>
+    auto
+    try_lock_shared_until(std::chrono::time_point<Clock, Duration> const& tp)
+      -> decltype(std::declval<L&>().try_lock_shared_until(tp));
+
+    template<typename L = Lockable>
+    auto unlock_shared() -> decltype(std::declval<L&>().unlock_shared());
+
+    lock_stats const& stats() const noexcept;
+
+private:
+    void lock(std::true_type has_try_lock);
+
+    void lock(std::false_type has_try_lock);
+
+    void record_uncontended();
+
+    void record_contended(clock_type::time_point start);
+
+    lock_stats stats_;
+    clock_type::time_point acquired_at_;
+    Lockable lockable_;
+};
+
+#endif // defined(NETU_DISABLE_LOCK_INSTRUMENTATION)
+
+} // namespace netu
+
+#include <netu/impl/instrumented_lockable.hpp>
+
+#endif // NETU_INSTRUMENTED_LOCKABLE_HPP
@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_RCU_VALUE_HPP
+#define NETU_RCU_VALUE_HPP
+
+#include <netu/detail/hazard_pointers.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+namespace netu
+{
+
+// Read-mostly value, which readers access through immutable snapshots.
+//
+// Const apply() invokes the callable with the current snapshot of each value,
+// without blocking and without writing to memory shared with other readers.
+// Snapshots of different values are not taken atomically with respect to each
+// other. A thread can hold at most 4 snapshots at a time, so const apply()
+// calls nested too deeply throw std::length_error.
+//
+// Mutating apply() copies the current value, invokes the callable on the copy
+// and publishes the result, unless the callable throws. Writers are
+// serialized by Lockable. Replaced snapshots are reclaimed once no reader
+// refers to them.
+template<typename T, typename Lockable = std::mutex>
+class rcu_value
+{
+public:
+    using value_type = T;
+    using mutex_type = Lockable;
+
+    rcu_value();
+
+    template<typename Arg1, typename... Args>
+    explicit rcu_value(Arg1&& arg1, Args&&... args);
+
+    rcu_value(rcu_value&&) = delete;
+    rcu_value(rcu_value const&) = delete;
+
+    rcu_value& operator=(rcu_value&&) = delete;
+    rcu_value& operator=(rcu_value const&) = delete;
+
+    // No readers may access the value concurrently with destruction
+    ~rcu_value();
+
+    template<typename Callable, typename U, typename L>
+    friend auto apply(Callable&& f, rcu_value<U, L>& rv)
+      -> decltype(std::forward<Callable>(f)(std::declval<U&>()));
+
+    template<typename Callable, typename... Ts, typename... Lockables>
+    friend auto apply(Callable&& f, rcu_value<Ts, Lockables> const&... rvs)
+      -> decltype(std::forward<Callable>(f)(std::declval<Ts const&>()...));
+
+private:
+    struct node
+    {
+        template<typename... Args>
+        explicit node(Args&&... args)
+          : value_{std::forward<Args>(args)...}
+        {
+        }
+
+        T value_;
+        node* retired_next_ = nullptr;
+    };
+
+    class publisher;
+
+    void retire(node* n) noexcept;
+
+    void reclaim() noexcept;
+
+    std::atomic<node*> current_;
+    node* retired_ = nullptr;
+    Lockable mutex_;
+};
+
+} // namespace netu
+
+#include <netu/impl/rcu_value.hpp>
+
+#endif // NETU_RCU_VALUE_HPP
@@ -0,0 +1,74 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_SEQLOCK_HPP
+#define NETU_SEQLOCK_HPP
+
+#include <netu/synchronized_value.hpp>
+
+#include <atomic>
+
+namespace netu
+{
+
+// Lockable which lets readers proceed without writing to shared memory.
+// Writers lock it like a spinlock and bump the sequence number, while readers
+// copy the protected data and retry if the sequence number changed in the
+// meantime. Readers are not wait-free: they spin while a writer holds the
+// lock.
+//
+// Const apply() of synchronized_value<T, seqlock> invokes the callable with
+// consistent snapshots of the values, instead of locking. Mutating apply()
+// locks the values and invokes the callable with copies of them, which are
+// written back before unlocking. Both sides copy the values with relaxed
+// atomic loads and stores, so that concurrent reads and writes don't race.
+// Values protected by a seqlock can't be modified by any other apply()
+// overload.
+class seqlock
+{
+public:
+    using sequence_type = unsigned;
+
+    seqlock() = default;
+
+    seqlock(seqlock const&) = delete;
+    seqlock& operator=(seqlock const&) = delete;
+
+    void lock() noexcept;
+
+    bool try_lock() noexcept;
+
+    void unlock() noexcept;
+
+    // Waits for the current writer (if any) and returns the sequence number
+    // that has to be passed to read_retry().
+    sequence_type read_begin() const noexcept;
+
+    // Returns true if data read since read_begin() may be inconsistent.
+    bool read_retry(sequence_type seq) const noexcept;
+
+private:
+    std::atomic<sequence_type> seq_{0};
+};
+
+template<typename Callable, typename... Ts, typename... Layouts>
+auto
+apply(Callable&& f, synchronized_value<Ts, seqlock, Layouts>&... svs)
+  -> decltype(std::forward<Callable>(f)(svs.value_...));
+
+template<typename Callable, typename... Ts, typename... Layouts>
+auto
+apply(Callable&& f, synchronized_value<Ts, seqlock, Layouts> const&... svs)
+  -> decltype(std::forward<Callable>(f)(svs.value_...));
+
+} // namespace netu
+
+#include <netu/impl/seqlock.hpp>
+
+#endif // NETU_SEQLOCK_HPP
@@ -0,0 +1,93 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_SHARDED_VALUE_HPP
+#define NETU_SHARDED_VALUE_HPP
+
+#include <netu/synchronized_array.hpp>
+
+#include <boost/mp11/integer_sequence.hpp>
+
+#include <cstddef>
+
+namespace netu
+{
+
+namespace detail
+{
+
+template<typename Callable, typename Shards, std::size_t... Is>
+auto
+apply_shards(Callable&& f,
+             Shards const& shards,
+             boost::mp11::index_sequence<Is...>)
+  -> decltype(netu::apply(std::forward<Callable>(f), shards[Is]...));
+
+} // namespace detail
+
+// Value split into N independently locked shards, each on its own cache
+// line. Every thread is assigned a shard, so that threads updating the value
+// concurrently rarely contend on the same lock.
+//
+// Mutating apply() invokes the callable with the calling thread's shard.
+// Const apply() locks all shards at once and invokes the callable with N
+// arguments, one for each shard.
+template<typename T, std::size_t N, typename Lockable = std::mutex>
+class sharded_value
+{
+    static_assert(N > 0, "At least one shard is required");
+
+public:
+    using value_type = T;
+    using mutex_type = Lockable;
+    using shard_type = synchronized_value<T, Lockable, colocated_layout>;
+
+    static constexpr std::size_t shard_count = N;
+
+    sharded_value() = default;
+
+    sharded_value(sharded_value&&) = delete;
+    sharded_value(sharded_value const&) = delete;
+
+    sharded_value& operator=(sharded_value&&) = delete;
+    sharded_value& operator=(sharded_value const&) = delete;
+
+    ~sharded_value() = default;
+
+    // Folds all shards into init, locking one shard at a time. The result
+    // does not have to correspond to a single point in time.
+    template<typename U, typename BinaryOperation>
+    U combine(U init, BinaryOperation op) const;
+
+    shard_type& shard(std::size_t i) noexcept;
+
+    shard_type const& shard(std::size_t i) const noexcept;
+
+    // Returns the shard used by the calling thread
+    shard_type& local_shard() noexcept;
+
+    template<typename Callable, typename U, std::size_t M, typename L>
+    friend auto apply(Callable&& f, sharded_value<U, M, L>& sv)
+      -> decltype(std::forward<Callable>(f)(std::declval<U&>()));
+
+    template<typename Callable, typename U, std::size_t M, typename L>
+    friend auto apply(Callable&& f, sharded_value<U, M, L> const& sv)
+      -> decltype(detail::apply_shards(std::forward<Callable>(f),
+                                       sv.shards_,
+                                       boost::mp11::make_index_sequence<M>{}));
+
+private:
+    synchronized_array<T, N, Lockable, colocated_layout> shards_;
+};
+
+} // namespace netu
+
+#include <netu/impl/sharded_value.hpp>
+
+#endif // NETU_SHARDED_VALUE_HPP
@@ -0,0 +1,70 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#ifndef NETU_SYNCHRONIZED_ARRAY_HPP
+#define NETU_SYNCHRONIZED_ARRAY_HPP
+
+#include <netu/synchronized_value.hpp>
+
+#include <array>
+#include <cstddef>
+
+namespace netu
+{
+
+// Fixed-size array of value-initialized synchronized_values, e.g. per-worker
+// state. By default, each element occupies its own cache lines, so that
+// threads working on different elements don't cause false sharing.
+template<typename T,
+         std::size_t N,
+         typename Lockable = std::mutex,
+         typename Layout = colocated_layout>
+class synchronized_array
+{
+public:
+    using value_type = synchronized_value<T, Lockable, Layout>;
+    using size_type = std::size_t;
+    using reference = value_type&;
+    using const_reference = value_type const&;
+    using iterator = typename std::array<value_type, N>::iterator;
+    using const_iterator = typename std::array<value_type, N>::const_iterator;
+
+    synchronized_array() = default;
+
+    synchronized_array(synchronized_array&&) = delete;
+    synchronized_array(synchronized_array const&) = delete;
+
+    synchronized_array& operator=(synchronized_array&&) = delete;
+    synchronized_array& operator=(synchronized_array const&) = delete;
+
+    ~synchronized_array() = default;
+
+    reference operator[](size_type i) noexcept;
+
+    const_reference operator[](size_type i) const noexcept;
+
+    static constexpr size_type size() noexcept;
+
+    iterator begin() noexcept;
+
+    const_iterator begin() const noexcept;
+
+    iterator end() noexcept;
+
+    const_iterator end() const noexcept;
+
+private:
+    std::array<value_type, N> elements_{};
+};
+
+} // namespace netu
+
+#include <netu/impl/synchronized_array.hpp>
+
+#endif // NETU_SYNCHRONIZED_ARRAY_HPP
@@ -11,23 +11,52 @@
 #define NETU_SYNCHRONIZED_STREAM_HPP
 
 #include <netu/detail/async_utils.hpp>
+#include <netu/detail/recycling_allocator.hpp>
+#include <netu/detail/write_queue.hpp>
 
 #include <boost/asio/associated_allocator.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/strand.hpp>
 
+#include <memory>
+#include <type_traits>
+
 namespace netu
 {
 
+namespace detail
+{
+
+template<typename Executor, typename WriteExecutor>
+struct write_executor
+{
+    using type = executor_from_context_t<WriteExecutor>;
+};
+
+template<typename Executor>
+struct write_executor<Executor, void>
+{
+    using type = executor_from_context_t<Executor>;
+};
+
+} // namespace detail
+
+// Reads and writes complete on Executor, which by default is a single strand.
+// If WriteExecutor is not void, writes complete on a separate instance of it
+// instead, so that reads and writes of a full-duplex stream are not
+// serialized against each other.
 template<typename NextLayer,
          typename Executor =
-           boost::asio::strand<typename NextLayer::executor_type>>
+           boost::asio::strand<typename NextLayer::executor_type>,
+         typename WriteExecutor = void>
 class synchronized_stream
 {
 public:
     using next_layer_type = NextLayer;
     using lowest_layer_type = typename NextLayer::lowest_layer_type;
     using executor_type = detail::executor_from_context_t<Executor>;
+    using write_executor_type =
+      typename detail::write_executor<Executor, WriteExecutor>::type;
 
     explicit synchronized_stream(boost::asio::io_context& ctx);
 
@@ -39,6 +68,13 @@ public:
     template<typename StreamArg, typename ExecutorArg>
     synchronized_stream(StreamArg&& sa, ExecutorArg&& ea);
 
+    template<typename StreamArg,
+             typename ExecutorArg,
+             typename WriteExecutorArg>
+    synchronized_stream(StreamArg&& sa,
+                        ExecutorArg&& ea,
+                        WriteExecutorArg&& wea);
+
     template<typename MutableBuffers, typename CompletionToken>
     auto async_read_some(MutableBuffers&& b, CompletionToken&& tok)
       -> detail::io_completion_result_t<CompletionToken>;
@@ -47,11 +83,70 @@ public:
     auto async_write_some(ConstBuffers&& b, CompletionToken&& tok)
       -> detail::io_completion_result_t<CompletionToken>;
 
+    // Writes all of the buffers and may be called concurrently from multiple
+    // threads. Concurrent writes are queued and their buffers are gathered
+    // into a single write_some, in the order of the calls. The handler is
+    // invoked once all of its bytes have been written, and handlers are
+    // invoked in the order of the calls. If a handler throws, the remaining
+    // handlers of its write_some are posted to the write executor, so they
+    // only stay in order if the write executor doesn't run handlers
+    // concurrently, e.g. a strand.
+    template<typename ConstBuffers, typename CompletionToken>
+    auto async_write(ConstBuffers const& b, CompletionToken&& tok)
+      -> detail::io_completion_result_t<CompletionToken>;
+
+    // Synchronous operations are performed directly on the next layer.
+    template<typename MutableBuffers>
+    std::size_t read_some(MutableBuffers const& b);
+
+    template<typename MutableBuffers>
+    std::size_t read_some(MutableBuffers const& b,
+                          boost::system::error_code& ec);
+
+    template<typename ConstBuffers>
+    std::size_t write_some(ConstBuffers const& b);
+
+    template<typename ConstBuffers>
+    std::size_t write_some(ConstBuffers const& b,
+                           boost::system::error_code& ec);
+
+    // In non-blocking mode, synchronous operations which can't make progress
+    // right away fail with would_block. Speculative I/O requires non-blocking
+    // mode, so disabling it also disables speculative I/O.
+    void non_blocking(bool mode);
+
+    void non_blocking(bool mode, boost::system::error_code& ec);
+
+    bool non_blocking() const
+    {
+        return lowest_layer().non_blocking();
+    }
+
+    // Speculative I/O first tries to read or write without waiting and only
+    // waits for readiness if that would block. Operations which make progress
+    // right away complete through a post to their executor. Enables
+    // non-blocking mode until speculative I/O is disabled again, so it is only
+    // available if the next layer is the lowest layer. Must not be changed
+    // while operations are outstanding.
+    void set_speculative_io(bool enabled);
+
+    void set_speculative_io(bool enabled, boost::system::error_code& ec);
+
+    bool speculative_io() const noexcept
+    {
+        return speculative_io_;
+    }
+
     executor_type get_executor() noexcept
     {
         return detail::get_executor_from_context(p_.second);
     }
 
+    write_executor_type get_write_executor() noexcept
+    {
+        return write_executor_;
+    }
+
     lowest_layer_type& lowest_layer()
     {
         return next_layer().lowest_layer();
@@ -73,10 +168,73 @@ public:
     }
 
 private:
-    template<typename CompletionHandler>
+    template<typename CompletionHandler, typename IoExecutor>
     class io_op;
 
+    class flush_op;
+
+    class complete_op;
+
+    template<typename Handler>
+    class speculative_op;
+
+    // Reading or writing a layer above the lowest one without waiting would
+    // bypass the intermediate layers.
+    using supports_speculative_io =
+      std::is_base_of<lowest_layer_type, next_layer_type>;
+
+    template<typename MutableBuffers>
+    std::size_t try_read_some(MutableBuffers const& b,
+                              boost::system::error_code& ec,
+                              std::true_type);
+
+    template<typename MutableBuffers>
+    std::size_t try_read_some(MutableBuffers const& b,
+                              boost::system::error_code& ec,
+                              std::false_type);
+
+    template<typename ConstBuffers>
+    std::size_t try_write_some(ConstBuffers const& b,
+                               boost::system::error_code& ec,
+                               std::true_type);
+
+    template<typename ConstBuffers>
+    std::size_t try_write_some(ConstBuffers const& b,
+                               boost::system::error_code& ec,
+                               std::false_type);
+
+    // Returns true if the handler has been posted with the result of a
+    // speculative operation.
+    template<typename Handler>
+    bool complete_speculative(Handler& h,
+                              boost::system::error_code ec,
+                              std::size_t n);
+
+    // Without a WriteExecutor, writes share the executor of reads.
+    // Otherwise, a new WriteExecutor wraps the executor of the next layer.
+    write_executor_type make_write_executor(std::true_type)
+    {
+        return p_.second;
+    }
+
+    write_executor_type make_write_executor(std::false_type)
+    {
+        return write_executor_type{p_.first.get_executor()};
+    }
+
     std::pair<next_layer_type, executor_type> p_;
+    write_executor_type write_executor_{
+      make_write_executor(std::is_void<WriteExecutor>{})};
+    std::unique_ptr<detail::write_queue> write_queue_{new detail::write_queue};
+
+    // Memory of the outstanding read and write operations. Reused by all
+    // operations whose handlers don't have a custom associated allocator.
+    detail::allocators::recycling_slot::pointer read_slot_{
+      detail::allocators::recycling_slot::create()};
+    detail::allocators::recycling_slot::pointer write_slot_{
+      detail::allocators::recycling_slot::create()};
+    bool speculative_io_ = false;
+    bool non_blocking_ = false;
 };
 
 } // namespace netu
@@ -10,18 +10,58 @@
 #ifndef NETU_SYNCHRONIZED_VALUE_HPP
 #define NETU_SYNCHRONIZED_VALUE_HPP
 
+#include <netu/cache_line_layout.hpp>
+
+#include <boost/mp11/integer_sequence.hpp>
+
+#include <chrono>
 #include <mutex>
+#include <tuple>
 #include <utility>
 
 namespace netu
 {
 
-template<typename T, typename Lockable = std::mutex>
+class seqlock;
+
+namespace detail
+{
+struct synchronized_value_access;
+
+template<typename R>
+struct try_apply_result;
+
+template<typename R>
+using try_apply_result_t = typename try_apply_result<R>::type;
+} // namespace detail
+
+// Locks the mutexes of multiple values using std::lock, which avoids
+// deadlocks by releasing the acquired locks and retrying whenever one of them
+// is busy. This is the default policy of apply().
+struct std_lock_policy
+{
+    template<typename... Lockables>
+    void operator()(Lockables&... ls) const;
+};
+
+// Locks the mutexes of multiple values one by one, in the order of their
+// addresses. A thread never has to release locks and retry, so there are no
+// retry storms under contention.
+struct ordered_lock_policy
+{
+    template<typename... Lockables>
+    void operator()(Lockables&... ls) const;
+};
+
+template<typename T,
+         typename Lockable = std::mutex,
+         typename Layout = default_layout>
 class synchronized_value
 {
 public:
     using value_type = T;
     using mutex_type = Lockable;
+    using layout_type = Layout;
 
     synchronized_value() = default;
 
@@ -31,6 +71,19 @@ public:
     {
     }
 
+    // Constructs the value from value_args and the Lockable from
+    // lockable_args, e.g. to give an instrumented_lockable its name.
+    template<typename... ValueArgs, typename... LockableArgs>
+    synchronized_value(std::piecewise_construct_t,
+                       std::tuple<ValueArgs...> value_args,
+                       std::tuple<LockableArgs...> lockable_args)
+      : synchronized_value{value_args,
+                           lockable_args,
+                           boost::mp11::index_sequence_for<ValueArgs...>{},
+                           boost::mp11::index_sequence_for<LockableArgs...>{}}
+    {
+    }
+
     synchronized_value(synchronized_value&&) = delete;
     synchronized_value(synchronized_value const&) = delete;
 
@@ -39,18 +92,124 @@ public:
 
     ~synchronized_value() = default;
 
-    template<typename Callable, typename... Ts, typename... Lockables>
-    friend auto apply(Callable&& f, synchronized_value<Ts, Lockables>&... svs)
+    template<typename Callable,
+             typename... Ts,
+             typename... Lockables,
+             typename... Layouts>
+    friend auto apply(Callable&& f,
+                      synchronized_value<Ts, Lockables, Layouts>&... svs)
       -> decltype(std::forward<Callable>(f)(svs.value_...));
 
-    template<typename Callable, typename... Ts, typename... Lockables>
+    // Lockables which are also SharedLockable (e.g. std::shared_mutex) are
+    // locked in shared mode, so that concurrent readers don't serialize.
+    template<typename Callable,
+             typename... Ts,
+             typename... Lockables,
+             typename... Layouts>
     friend auto apply(Callable&& f,
-                      synchronized_value<Ts, Lockables> const&... svs)
+                      synchronized_value<Ts, Lockables, Layouts> const&... svs)
       -> decltype(std::forward<Callable>(f)(svs.value_...));
 
+    template<typename Callable, typename... Ts, typename... Layouts>
+    friend auto apply(Callable&& f,
+                      synchronized_value<Ts, seqlock, Layouts>&... svs)
+      -> decltype(std::forward<Callable>(f)(svs.value_...));
+
+    template<typename Callable, typename... Ts, typename... Layouts>
+    friend auto apply(Callable&& f,
+                      synchronized_value<Ts, seqlock, Layouts> const&... svs)
+      -> decltype(std::forward<Callable>(f)(svs.value_...));
+
+    // Same as the above, but the locks are acquired with LockPolicy
+    template<typename LockPolicy,
+             typename Callable,
+             typename... Ts,
+             typename... Lockables,
+             typename... Layouts>
+    friend auto apply(LockPolicy const& policy,
+                      Callable&& f,
+                      synchronized_value<Ts, Lockables, Layouts>&... svs)
+      -> decltype(std::forward<Callable>(f)(svs.value_...));
+
+    template<typename LockPolicy,
+             typename Callable,
+             typename... Ts,
+             typename... Lockables,
+             typename... Layouts>
+    friend auto apply(LockPolicy const& policy,
+                      Callable&& f,
+                      synchronized_value<Ts, Lockables, Layouts> const&... svs)
+      -> decltype(std::forward<Callable>(f)(svs.value_...));
+
+    // Invokes f only if all the locks can be acquired without blocking.
+    // Returns an optional holding the result of f, which is empty if any of
+    // the locks was busy. If f returns void, returns whether f was invoked.
+    template<typename Callable,
+             typename... Ts,
+             typename... Lockables,
+             typename... Layouts>
+    friend auto try_apply(Callable&& f,
+                          synchronized_value<Ts, Lockables, Layouts>&... svs)
+      -> detail::try_apply_result_t<decltype(
+        std::forward<Callable>(f)(svs.value_...))>;
+
+    template<typename Callable,
+             typename... Ts,
+             typename... Lockables,
+             typename... Layouts>
+    friend auto
+    try_apply(Callable&& f,
+              synchronized_value<Ts, Lockables, Layouts> const&... svs)
+      -> detail::try_apply_result_t<decltype(
+        std::forward<Callable>(f)(svs.value_...))>;
+
+    // Same as try_apply(), but waits for the locks until deadline. Requires
+    // TimedLockables (or SharedTimedLockables in the const overload).
+    template<typename Clock,
+             typename Duration,
+             typename Callable,
+             typename... Ts,
+             typename... Lockables,
+             typename... Layouts>
+    friend auto
+    apply_until(std::chrono::time_point<Clock, Duration> const& deadline,
+                Callable&& f,
+                synchronized_value<Ts, Lockables, Layouts>&... svs)
+      -> detail::try_apply_result_t<decltype(
+        std::forward<Callable>(f)(svs.value_...))>;
+
+    template<typename Clock,
+             typename Duration,
+             typename Callable,
+             typename... Ts,
+             typename... Lockables,
+             typename... Layouts>
+    friend auto
+    apply_until(std::chrono::time_point<Clock, Duration> const& deadline,
+                Callable&& f,
+                synchronized_value<Ts, Lockables, Layouts> const&... svs)
+      -> detail::try_apply_result_t<decltype(
+        std::forward<Callable>(f)(svs.value_...))>;
+
 private:
-    T value_;
-    mutable Lockable mutex_;
+    friend struct detail::synchronized_value_access;
+
+    template<typename... ValueArgs,
+             typename... LockableArgs,
+             std::size_t... Is,
+             std::size_t... Js>
+    synchronized_value(std::tuple<ValueArgs...>& value_args,
+                       std::tuple<LockableArgs...>& lockable_args,
+                       boost::mp11::index_sequence<Is...>,
+                       boost::mp11::index_sequence<Js...>)
+      : value_(std::forward<ValueArgs>(std::get<Is>(value_args))...)
+      , mutex_(std::forward<LockableArgs>(std::get<Js>(lockable_args))...)
+    {
+    }
+
+    alignas(Layout::template value_alignment<T>()) T value_;
+    alignas(Layout::template mutex_alignment<Lockable>()) mutable Lockable
+      mutex_;
 };
 
 } // namespace netu
@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/adaptive_mutex.hpp>
+#include <netu/synchronized_value.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace netu
+{
+
+BOOST_AUTO_TEST_CASE(adaptive_mutex_lockable)
+{
+    adaptive_mutex m;
+    BOOST_TEST(m.try_lock());
+    BOOST_TEST(!m.try_lock());
+    m.unlock();
+
+    m.lock();
+    BOOST_TEST(!m.try_lock());
+    m.unlock();
+    BOOST_TEST(m.try_lock());
+    m.unlock();
+}
+
+BOOST_AUTO_TEST_CASE(adaptive_mutex_parking)
+{
+    adaptive_mutex m;
+    bool acquired = false;
+
+    m.lock();
+    std::thread t{[&]() {
+        m.lock();
+        acquired = true;
+        m.unlock();
+    }};
+
+    // Long enough for the other thread to give up spinning and park
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    m.unlock();
+    t.join();
+    BOOST_TEST(acquired);
+}
+
+BOOST_AUTO_TEST_CASE(adaptive_mutex_apply)
+{
+    synchronized_value<std::uint64_t, adaptive_mutex> sv1{0u};
+    synchronized_value<std::uint64_t, adaptive_mutex> sv2{0u};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < 10000; ++j)
+            {
+                netu::apply([](std::uint64_t& v) { ++v; }, sv1);
+                netu::apply(
+                  [](std::uint64_t& v1, std::uint64_t& v2) {
+                      --v1;
+                      v2 += 2;
+                  },
+                  sv1,
+                  sv2);
+            }
+        });
+    }
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    BOOST_TEST(netu::apply([](std::uint64_t& v) { return v; }, sv1) == 0u);
+    BOOST_TEST(netu::apply([](std::uint64_t& v) { return v; }, sv2) ==
+               80000u);
+}
+
+} // namespace netu
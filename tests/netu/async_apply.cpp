@@ -0,0 +1,191 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/async_apply.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/test/unit_test.hpp>
+#include <netu/test/allocator.hpp>
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace netu
+{
+
+BOOST_AUTO_TEST_CASE(async_mutex_lockable)
+{
+    boost::asio::io_context ctx;
+    async_mutex m;
+    std::vector<int> order;
+
+    BOOST_TEST(m.try_lock());
+    BOOST_TEST(!m.try_lock());
+
+    for (int i = 0; i < 3; ++i)
+    {
+        m.async_lock(boost::asio::bind_executor(ctx, [&, i]() {
+            order.push_back(i);
+            m.unlock();
+        }));
+    }
+
+    // Queued handlers keep the io_context busy
+    BOOST_TEST(ctx.poll() == 0u);
+    BOOST_TEST(!ctx.stopped());
+
+    m.unlock();
+    ctx.run();
+    BOOST_TEST(order == (std::vector<int>{0, 1, 2}));
+
+    m.lock();
+    m.unlock();
+}
+
+// Handler whose posting fails once the allocator runs out
+struct counting_handler
+{
+    using allocator_type = test::allocator<char>;
+    using executor_type = boost::asio::io_context::executor_type;
+
+    allocator_type get_allocator() const noexcept
+    {
+        return alloc_;
+    }
+
+    executor_type get_executor() const noexcept
+    {
+        return ex_;
+    }
+
+    void operator()()
+    {
+        ++*invoked_;
+        m_->unlock();
+    }
+
+    allocator_type alloc_;
+    executor_type ex_;
+    async_mutex* m_;
+    int* invoked_;
+};
+
+BOOST_AUTO_TEST_CASE(async_mutex_failed_handover)
+{
+    boost::asio::io_context ctx;
+    async_mutex m;
+    // Storing a handler takes one allocation, posting it takes another
+    test::allocator_control failing{};
+    failing.allocatons_left = 1;
+    failing.constructions_left = 2;
+    test::allocator_control working{};
+    working.allocatons_left = 2;
+    working.constructions_left = 2;
+    int invoked = 0;
+
+    BOOST_TEST(m.try_lock());
+    m.async_lock(counting_handler{
+      test::allocator<char>{failing}, ctx.get_executor(), &m, &invoked});
+    m.async_lock(counting_handler{
+      test::allocator<char>{working}, ctx.get_executor(), &m, &invoked});
+
+    // The lock passes to the second handler
+    BOOST_CHECK_THROW(m.unlock(), test::allocation_failure);
+    BOOST_TEST(!m.try_lock());
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+
+    // And is released if no handler is left
+    failing.allocatons_left = 1;
+    BOOST_TEST(m.try_lock());
+    m.async_lock(counting_handler{
+      test::allocator<char>{failing}, ctx.get_executor(), &m, &invoked});
+    BOOST_CHECK_THROW(m.unlock(), test::allocation_failure);
+    BOOST_TEST(m.try_lock());
+    m.unlock();
+}
+
+BOOST_AUTO_TEST_CASE(async_apply_io_context)
+{
+    boost::asio::io_context ctx;
+    synchronized_value<int, async_mutex> sv{0};
+    std::vector<int> results;
+    bool invoked = false;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        async_apply(
+          ctx, sv, [](int& v) { return ++v; }, [&](int r) {
+              results.push_back(r);
+          });
+    }
+    async_apply(ctx, sv, [](int& v) { v *= 10; }, [&]() { invoked = true; });
+
+    // Handlers are never invoked from within the initiating function
+    BOOST_TEST(results.empty());
+    ctx.run();
+
+    BOOST_TEST(results == (std::vector<int>{1, 2, 3}));
+    BOOST_TEST(invoked);
+    BOOST_TEST(netu::apply([](int& v) { return v; }, sv) == 30);
+}
+
+BOOST_AUTO_TEST_CASE(async_apply_contended)
+{
+    boost::asio::io_context ctx;
+    synchronized_value<int, async_mutex> sv{0};
+    std::atomic<bool> locked{false};
+    std::atomic<bool> release{false};
+    int result = 0;
+
+    std::thread t{[&]() {
+        netu::apply(
+          [&](int& v) {
+              locked = true;
+              while (!release)
+              {
+                  std::this_thread::yield();
+              }
+              v = 42;
+          },
+          sv);
+    }};
+
+    while (!locked)
+    {
+        std::this_thread::yield();
+    }
+
+    async_apply(ctx, sv, [](int& v) { return v + 1; }, [&](int r) {
+        result = r;
+    });
+
+    // The io_context thread isn't blocked by the contended lock
+    BOOST_TEST(ctx.poll() == 0u);
+    BOOST_TEST(result == 0);
+
+    release = true;
+    t.join();
+    ctx.run();
+    BOOST_TEST(result == 43);
+}
+
+BOOST_AUTO_TEST_CASE(async_apply_future)
+{
+    synchronized_value<int, async_mutex> sv{41};
+    std::future<int> f =
+      async_apply(sv, [](int& v) { return ++v; }, boost::asio::use_future);
+    BOOST_TEST(f.get() == 42);
+}
+
+} // namespace netu
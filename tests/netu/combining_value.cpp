@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/combining_value.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace netu
+{
+
+namespace
+{
+
+template<typename CombiningValue>
+void
+run_increments(CombiningValue& cv, int thread_count, int increments)
+{
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; ++i)
+    {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < increments; ++j)
+            {
+                netu::apply([](std::uint64_t& v) { return ++v; }, cv);
+            }
+        });
+    }
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(combining_apply)
+{
+    combining_value<int> cv{42};
+    auto const& ccv = cv;
+
+    BOOST_TEST(netu::apply([](int& v) { return v++; }, cv) == 42);
+    BOOST_TEST(netu::apply([](int const& v) { return v; }, ccv) == 43);
+
+    int& ref = netu::apply([](int& v) -> int& { return v; }, cv);
+    ref = 44;
+    netu::apply([](int& v) { BOOST_TEST(v == 44); }, cv);
+
+    auto p = netu::apply(
+      [](int& v) { return std::unique_ptr<int>{new int{v}}; }, cv);
+    BOOST_TEST(*p == 44);
+}
+
+BOOST_AUTO_TEST_CASE(combining_exception)
+{
+    combining_value<int> cv{42};
+
+    BOOST_CHECK_THROW(
+      netu::apply([](int&) -> int { throw std::runtime_error{"test"}; }, cv),
+      std::runtime_error);
+    BOOST_TEST(netu::apply([](int& v) { return v; }, cv) == 42);
+}
+
+BOOST_AUTO_TEST_CASE(combining_concurrent)
+{
+    combining_value<std::uint64_t> cv{0u};
+    run_increments(cv, 8, 10000);
+    BOOST_TEST(netu::apply([](std::uint64_t& v) { return v; }, cv) == 80000u);
+
+    // More threads than slots, so some of them have to bypass combining
+    combining_value<std::uint64_t, std::mutex, 2> small{0u};
+    run_increments(small, 8, 10000);
+    BOOST_TEST(netu::apply([](std::uint64_t& v) { return v; }, small) ==
+               80000u);
+}
+
+} // namespace netu
@@ -9,16 +9,22 @@
 
 #include <netu/completion_handler.hpp>
 
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/make_unique.hpp>
 #include <boost/test/unit_test.hpp>
 #include <netu/test/allocator.hpp>
 
+#include <thread>
+
 namespace netu
 {
 
-template<typename R, typename... Ts>
+template<typename R, typename... Ts, std::size_t C, std::size_t A>
 std::ostream&
-operator<<(std::ostream& stream, completion_handler<R(Ts...)> const& ch)
+operator<<(std::ostream& stream, completion_handler<R(Ts...), C, A> const& ch)
 {
     stream << std::boolalpha << static_cast<bool>(ch);
     return stream;
@@ -51,6 +57,29 @@ struct fat_functor
     }
 };
 
+struct medium_functor
+{
+    using allocator_type = test::allocator<medium_functor>;
+
+    alignas(16) std::array<char, 40> data_{};
+    allocator_type alloc_;
+
+    explicit medium_functor(test::allocator<medium_functor> alloc)
+      : alloc_{alloc}
+    {
+    }
+
+    allocator_type get_allocator() const noexcept
+    {
+        return alloc_;
+    }
+
+    int operator()()
+    {
+        return 0xC0FFEE;
+    }
+};
+
 static_assert(std::is_same<boost::asio::associated_allocator_t<fat_functor>,
                            fat_functor::allocator_type>::value,
               "Wrong associated allocator");
@@ -128,6 +157,189 @@ BOOST_AUTO_TEST_CASE(allocation)
     BOOST_TEST(ctrl.deallocations == 1);
 }
 
+BOOST_AUTO_TEST_CASE(custom_capacity)
+{
+    static_assert(sizeof(completion_handler<void(), 64, 16>) >= 64,
+                  "Capacity not respected");
+    static_assert(alignof(completion_handler<void(), 64, 16>) >= 16,
+                  "Alignment not respected");
+
+    test::allocator_control ctrl{};
+    medium_functor mf{test::allocator<medium_functor>{ctrl}};
+    {
+        completion_handler<int()> ch;
+        BOOST_CHECK_THROW(ch = mf, test::allocation_failure);
+        BOOST_TEST(!ch);
+    }
+
+    {
+        completion_handler<int(), 64, 16> ch = mf;
+        BOOST_TEST(!!ch);
+
+        completion_handler<int(), 64, 16> ch_move{std::move(ch)};
+        BOOST_TEST(!ch);
+        BOOST_TEST(ch_move != nullptr);
+
+        swap(ch, ch_move);
+        BOOST_TEST(ch.invoke() == 0xC0FFEE);
+        BOOST_TEST(ch == nullptr);
+    }
+
+    BOOST_TEST(ctrl.allocatons_left == 0);
+    BOOST_TEST(ctrl.destructions == 0);
+    BOOST_TEST(ctrl.deallocations == 0);
+}
+
+BOOST_AUTO_TEST_CASE(recycling_allocation)
+{
+    using detail::allocators::handler_alloc_t;
+    using detail::allocators::recycling_allocator;
+    using detail::allocators::thread_cache;
+
+    static_assert(std::is_same<handler_alloc_t<fat_functor, int>,
+                               test::allocator<int>>::value,
+                  "Custom allocators must not be replaced");
+
+    auto big_lambda = [](std::array<char, 200> const&) {};
+    static_assert(
+      std::is_same<handler_alloc_t<decltype(big_lambda), int>,
+                   recycling_allocator<int>>::value,
+      "Handlers with std::allocator must use the recycling allocator");
+
+    void* p1 = thread_cache::allocate(200);
+    thread_cache::deallocate(p1, 200);
+    void* p2 = thread_cache::allocate(256);
+    BOOST_TEST(p1 == p2);
+    thread_cache::deallocate(p2, 256);
+
+    // The handler's block must be recycled before the handler is invoked
+    std::array<char, 200> data{};
+    void* reused = nullptr;
+    completion_handler<int()> ch = [data, &reused]() {
+        reused = thread_cache::allocate(sizeof(data));
+        return static_cast<int>(data[0]) + 1;
+    };
+    BOOST_TEST(ch.invoke() == 1);
+    BOOST_TEST(reused == p1);
+    thread_cache::deallocate(reused, sizeof(data));
+}
+
+BOOST_AUTO_TEST_CASE(relocation)
+{
+    int i = 0;
+    auto trivial = [&i]() { return ++i; };
+    auto shared = std::make_shared<int>(0xC0FFEE);
+    auto non_trivial = [shared]() { return *shared; };
+
+    using trivial_vtable_t =
+      detail::vtable_generator<detail::small_functor<decltype(trivial)>,
+                               int()>;
+    static_assert(trivial_vtable_t::value.manage == nullptr,
+                  "Trivially relocatable handlers must not have a manager");
+    static_assert(!detail::is_trivially_relocatable<
+                    detail::small_functor<decltype(non_trivial)>>::value,
+                  "Handlers with non-trivial captures are not relocatable");
+
+    completion_handler<int()> ch1 = trivial;
+    completion_handler<int()> ch2 = non_trivial;
+    BOOST_TEST(shared.use_count() == 3);
+
+    swap(ch1, ch2);
+    completion_handler<int()> ch3{std::move(ch1)};
+    BOOST_TEST(shared.use_count() == 3);
+    BOOST_TEST(ch1 == nullptr);
+
+    BOOST_TEST(ch2.invoke() == 1);
+    BOOST_TEST(ch3.invoke() == 0xC0FFEE);
+    BOOST_TEST(shared.use_count() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(associated_executor)
+{
+    boost::asio::io_context ctx;
+    boost::asio::strand<boost::asio::io_context::executor_type> strand{
+      ctx.get_executor()};
+
+    // Handlers without an associated executor don't need a polymorphic one
+    completion_handler<void()> ch;
+    BOOST_TEST(!boost::asio::get_associated_executor(ch).associated());
+    BOOST_TEST(
+      &boost::asio::get_associated_executor(ch, ctx.get_executor()).context() ==
+      &ctx);
+
+    bool ran_in_strand = false;
+    ch = boost::asio::bind_executor(
+      strand, [&]() { ran_in_strand = strand.running_in_this_thread(); });
+    BOOST_TEST((boost::asio::get_associated_executor(ch).associated() ==
+                boost::asio::executor{strand}));
+    BOOST_TEST(
+      (boost::asio::get_associated_executor(ch, ctx.get_executor())
+         .associated() == boost::asio::executor{strand}));
+
+    completion_handler<void()> ch_func_ptr{func_ptr};
+    BOOST_TEST(!boost::asio::get_associated_executor(ch_func_ptr).associated());
+
+    // Nested erased handlers keep the association of the innermost handler
+    using nested_type = completion_handler<void(), 64>;
+    BOOST_TEST(!boost::asio::get_associated_executor(
+                  nested_type{std::move(ch_func_ptr)})
+                  .associated());
+
+    nested_type nested{std::move(ch)};
+    BOOST_TEST((boost::asio::get_associated_executor(nested).associated() ==
+                boost::asio::executor{strand}));
+
+    boost::asio::post(std::move(nested));
+    ctx.run();
+    BOOST_TEST(ran_in_strand);
+
+    // Handlers without an associated executor fall back to the one supplied
+    // by the caller, e.g. the I/O executor of a composed operation.
+    auto const id = std::this_thread::get_id();
+    bool ran_in_ctx = false;
+    ch = [&]() { ran_in_ctx = std::this_thread::get_id() == id; };
+    auto ex = boost::asio::get_associated_executor(ch, ctx.get_executor());
+    BOOST_TEST(!ex.associated());
+    BOOST_TEST(&ex.context() == &ctx);
+    boost::asio::post(ex, std::move(ch));
+    ctx.restart();
+    ctx.run();
+    BOOST_TEST(ran_in_ctx);
+}
+
+BOOST_AUTO_TEST_CASE(associated_allocator)
+{
+    test::allocator_control ctrl{};
+    {
+        using detail::allocators::erase_allocator;
+
+        completion_handler<void()> ch;
+        BOOST_TEST(
+          (ch.get_allocator() == erase_allocator(std::allocator<void>{})));
+
+        ctrl.allocatons_left = 1;
+        ctrl.constructions_left = 1;
+        ch = fat_functor{test::allocator<fat_functor>{ctrl}};
+        BOOST_TEST(ctrl.allocatons_left == 0);
+
+        auto alloc = boost::asio::get_associated_allocator(ch);
+        BOOST_TEST(
+          (alloc == erase_allocator(test::allocator<fat_functor>{ctrl})));
+        using op_alloc_t = std::allocator_traits<
+          decltype(alloc)>::rebind_alloc<std::array<char, 100>>;
+        op_alloc_t op_alloc{alloc};
+        BOOST_CHECK_THROW(op_alloc.allocate(1), test::allocation_failure);
+
+        ctrl.allocatons_left = 1;
+        auto* p = op_alloc.allocate(1);
+        BOOST_TEST(ctrl.allocatons_left == 0);
+        op_alloc.deallocate(p, 1);
+        BOOST_TEST(ctrl.deallocations == 1);
+    }
+    BOOST_TEST(ctrl.deallocations == 2);
+    BOOST_TEST(ctrl.destructions == 1);
+}
+
 BOOST_AUTO_TEST_CASE(assignment)
 {
     completion_handler<void(void)> ch;
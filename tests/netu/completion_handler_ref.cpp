@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/completion_handler_ref.hpp>
+
+#include <netu/synchronized_value.hpp>
+
+#include <boost/make_unique.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace netu
+{
+
+static_assert(std::is_trivially_copyable<completion_handler_ref<void()>>::value,
+              "completion_handler_ref must be trivially copyable");
+static_assert(sizeof(completion_handler_ref<void()>) == 2 * sizeof(void*),
+              "completion_handler_ref must be two words");
+
+namespace
+{
+
+int
+incompatible_func(const std::string&)
+{
+    return 0xDEADBEEF;
+}
+
+struct counting_functor
+{
+    int operator()(int i)
+    {
+        count_ += i;
+        return count_;
+    }
+
+    int count_ = 0;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(invocation)
+{
+    counting_functor cf;
+    completion_handler_ref<int(int)> ref = cf;
+    BOOST_TEST(ref(1) == 1);
+    BOOST_TEST(ref(2) == 3);
+    BOOST_TEST(cf.count_ == 3);
+
+    auto copy = ref;
+    BOOST_TEST(copy(3) == 6);
+
+    completion_handler_ref<int(std::string)> ref_func = incompatible_func;
+    BOOST_TEST(ref_func("str") == 0xDEADBEEF);
+    ref_func = &incompatible_func;
+    BOOST_TEST(ref_func("str") == 0xDEADBEEF);
+
+    auto const lambda = [](std::unique_ptr<int> p) { return *p; };
+    completion_handler_ref<int(std::unique_ptr<int>)> ref_lambda = lambda;
+    BOOST_TEST(ref_lambda(boost::make_unique<int>(0xC0FFEE)) == 0xC0FFEE);
+}
+
+BOOST_AUTO_TEST_CASE(apply_callback)
+{
+    synchronized_value<int> sv{42};
+    auto f = [](int& v) { return ++v; };
+    completion_handler_ref<int(int&)> ref = f;
+    BOOST_TEST(netu::apply(ref, sv) == 43);
+    BOOST_TEST(netu::apply(ref, sv) == 44);
+}
+
+} // namespace netu
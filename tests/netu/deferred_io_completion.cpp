@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/deferred_io_completion.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+namespace netu
+{
+
+BOOST_AUTO_TEST_CASE(deferred_completion)
+{
+    boost::system::error_code result_ec;
+    std::size_t result_n = 0;
+
+    deferred_io_completion dc{
+      [&](boost::system::error_code ec, std::size_t n) {
+          result_ec = ec;
+          result_n = n;
+      },
+      boost::asio::error::eof,
+      42};
+    BOOST_TEST(!!dc);
+    BOOST_TEST(dc.error() == boost::asio::error::eof);
+    BOOST_TEST(dc.bytes_transferred() == 42u);
+
+    deferred_io_completion moved{std::move(dc)};
+    BOOST_TEST(!dc);
+    moved();
+    BOOST_TEST(!moved);
+    BOOST_TEST(result_ec == boost::asio::error::eof);
+    BOOST_TEST(result_n == 42u);
+}
+
+BOOST_AUTO_TEST_CASE(batch)
+{
+    deferred_io_batch b{4};
+    std::vector<std::size_t> results;
+
+    auto handler = [&](boost::system::error_code ec, std::size_t n) {
+        BOOST_TEST(!ec);
+        results.push_back(n);
+    };
+
+    for (std::size_t i = 0; i < 10; ++i)
+    {
+        b.push(handler, {}, i);
+    }
+    BOOST_TEST(b.size() == 10u);
+
+    BOOST_TEST(b.invoke() == 10u);
+    BOOST_TEST(b.empty());
+    BOOST_TEST(results ==
+               (std::vector<std::size_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+
+    // Completions pushed by invoked handlers run in the next batch
+    results.clear();
+    b.push(
+      [&](boost::system::error_code, std::size_t n) {
+          results.push_back(n);
+          b.push(handler, {}, n + 1);
+      },
+      {},
+      0);
+    BOOST_TEST(b.invoke() == 1u);
+    BOOST_TEST(b.size() == 1u);
+    BOOST_TEST(b.invoke() == 1u);
+    BOOST_TEST(results == (std::vector<std::size_t>{0, 1}));
+}
+
+BOOST_AUTO_TEST_CASE(batch_exception)
+{
+    deferred_io_batch b;
+    std::vector<std::size_t> results;
+
+    auto handler = [&](boost::system::error_code, std::size_t n) {
+        results.push_back(n);
+    };
+
+    b.push(handler, {}, 0);
+    b.push([](boost::system::error_code,
+              std::size_t) { throw std::runtime_error{"test"}; },
+           {},
+           1);
+    b.push(handler, {}, 2);
+
+    BOOST_CHECK_THROW(b.invoke(), std::runtime_error);
+    BOOST_TEST(b.size() == 1u);
+    BOOST_TEST(b.invoke() == 1u);
+    BOOST_TEST(results == (std::vector<std::size_t>{0, 2}));
+}
+
+} // namespace netu
@@ -0,0 +1,195 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/handler_queue.hpp>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace netu
+{
+
+BOOST_AUTO_TEST_CASE(push_drain)
+{
+    handler_queue<int(int)> q;
+    BOOST_TEST(q.drain(10, 0) == 0u);
+
+    std::vector<int> results;
+    for (int i = 0; i < 5; ++i)
+    {
+        q.push([&results, i](int v) {
+            results.push_back(i + v);
+            return i;
+        });
+    }
+
+    BOOST_TEST(q.drain(3, 10) == 3u);
+    BOOST_TEST(results == (std::vector<int>{10, 11, 12}));
+    BOOST_TEST(q.drain(10, 20) == 2u);
+    BOOST_TEST(results == (std::vector<int>{10, 11, 12, 23, 24}));
+    BOOST_TEST(q.drain(10, 0) == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(pending_handlers_destroyed)
+{
+    auto p = std::make_shared<int>(0);
+    {
+        handler_queue<void()> q;
+        q.push([p]() {});
+        q.push([p]() {});
+        BOOST_TEST(p.use_count() == 3);
+    }
+    BOOST_TEST(p.use_count() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(multiple_producers)
+{
+    constexpr int producers = 4;
+    constexpr int pushes = 10000;
+
+    boost::asio::io_context ctx;
+    handler_queue<void()> q{16};
+    int invoked = 0;
+
+    auto work = boost::asio::make_work_guard(ctx);
+    std::size_t wakeups = 0;
+    std::thread consumer{[&]() { wakeups = ctx.run(); }};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i)
+    {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < pushes; ++j)
+            {
+                q.post(ctx.get_executor(), [&invoked]() { ++invoked; });
+            }
+        });
+    }
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    work.reset();
+    consumer.join();
+    BOOST_TEST(invoked == producers * pushes);
+    BOOST_TEST(wakeups < static_cast<std::size_t>(invoked));
+}
+
+BOOST_AUTO_TEST_CASE(multiple_consumer_threads)
+{
+    constexpr int producers = 2;
+    constexpr int pushes = 10000;
+
+    boost::asio::io_context ctx;
+    handler_queue<void()> q{4};
+    std::atomic<int> running{0};
+    std::atomic<bool> overlapped{false};
+    int invoked = 0;
+
+    auto work = boost::asio::make_work_guard(ctx);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&]() { ctx.run(); });
+    }
+
+    std::vector<std::thread> producer_threads;
+    for (int i = 0; i < producers; ++i)
+    {
+        producer_threads.emplace_back([&]() {
+            for (int j = 0; j < pushes; ++j)
+            {
+                q.post(ctx.get_executor(), [&]() {
+                    // Queued handlers are invoked one at a time, even though
+                    // ctx is run by several threads
+                    if (running.fetch_add(1) != 0)
+                    {
+                        overlapped = true;
+                    }
+                    ++invoked;
+                    running.fetch_sub(1);
+                });
+            }
+        });
+    }
+
+    for (auto& t : producer_threads)
+    {
+        t.join();
+    }
+
+    work.reset();
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    BOOST_TEST(!overlapped);
+    BOOST_TEST(invoked == producers * pushes);
+}
+
+BOOST_AUTO_TEST_CASE(throwing_posted_handler)
+{
+    boost::asio::io_context ctx;
+    handler_queue<void()> q{2};
+    std::vector<int> invoked;
+    for (int i = 0; i < 5; ++i)
+    {
+        q.post(ctx.get_executor(), [&invoked, i]() {
+            invoked.push_back(i);
+            if (i == 0)
+            {
+                throw std::runtime_error{"handler"};
+            }
+        });
+    }
+
+    BOOST_CHECK_THROW(ctx.run(), std::runtime_error);
+    BOOST_TEST(invoked == (std::vector<int>{0}));
+
+    // The remaining handlers are still drained and later posts don't stall
+    ctx.restart();
+    ctx.run();
+    BOOST_TEST(invoked == (std::vector<int>{0, 1, 2, 3, 4}));
+
+    q.post(ctx.get_executor(), [&invoked]() { invoked.push_back(5); });
+    ctx.restart();
+    ctx.run();
+    BOOST_TEST(invoked.size() == 6u);
+}
+
+BOOST_AUTO_TEST_CASE(push_and_post_cannot_be_mixed)
+{
+    boost::asio::io_context ctx;
+
+    handler_queue<void()> pushed;
+    pushed.push([]() {});
+    BOOST_CHECK_THROW(pushed.post(ctx.get_executor(), []() {}),
+                      std::logic_error);
+    BOOST_TEST(pushed.drain(10) == 1u);
+
+    handler_queue<void()> posted;
+    int invoked = 0;
+    posted.post(ctx.get_executor(), [&invoked]() { ++invoked; });
+    BOOST_CHECK_THROW(posted.push([]() {}), std::logic_error);
+    BOOST_CHECK_THROW(posted.drain(10), std::logic_error);
+
+    // The drain operation finishes instead of spinning
+    BOOST_TEST(ctx.run() == 1u);
+    BOOST_TEST(invoked == 1);
+}
+
+} // namespace netu
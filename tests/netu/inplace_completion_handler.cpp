@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/inplace_completion_handler.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <netu/test/allocator.hpp>
+
+#include <array>
+
+namespace netu
+{
+
+template<typename S, std::size_t C, std::size_t A>
+std::ostream&
+operator<<(std::ostream& stream, inplace_completion_handler<S, C, A> const& ch)
+{
+    stream << std::boolalpha << static_cast<bool>(ch);
+    return stream;
+}
+
+namespace
+{
+
+int (*const func_ptr)() = []() { return 0xC0FFEE; };
+
+struct medium_functor
+{
+    using allocator_type = test::allocator<medium_functor>;
+
+    std::array<char, 40> data_{};
+    allocator_type alloc_;
+
+    explicit medium_functor(test::allocator<medium_functor> alloc)
+      : alloc_{alloc}
+    {
+    }
+
+    allocator_type get_allocator() const noexcept
+    {
+        return alloc_;
+    }
+
+    int operator()()
+    {
+        return 0xDEADBEEF;
+    }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(constructors)
+{
+    inplace_completion_handler<int()> ch{};
+    BOOST_TEST(!ch);
+
+    inplace_completion_handler<int()> ch_nullptr{nullptr};
+    BOOST_TEST(ch_nullptr == nullptr);
+
+    int i = 0;
+    auto lambda = [&i]() { return ++i; };
+    static_assert(
+      std::is_nothrow_constructible<inplace_completion_handler<int()>,
+                                    decltype(lambda)>::value,
+      "Inplace construction must not throw");
+    inplace_completion_handler<int()> ch_lambda{lambda};
+    BOOST_TEST(ch_lambda != nullptr);
+
+    inplace_completion_handler<int()> ch_move{std::move(ch_lambda)};
+    BOOST_TEST(ch_lambda == nullptr);
+    BOOST_TEST(ch_move.invoke() == 1);
+
+    inplace_completion_handler<int()> ch_func_ptr{func_ptr};
+    BOOST_TEST(ch_func_ptr() == 0xC0FFEE);
+
+    static_assert(
+      !std::is_constructible<inplace_completion_handler<void()>,
+                             inplace_completion_handler<void()>&>::value,
+      "Must not be constructible from a ref");
+}
+
+BOOST_AUTO_TEST_CASE(no_allocation)
+{
+    test::allocator_control ctrl{};
+    medium_functor mf{test::allocator<medium_functor>{ctrl}};
+
+    inplace_completion_handler<int(), 64> ch = mf;
+    BOOST_TEST(ch != nullptr);
+
+    inplace_completion_handler<int(), 64> ch2;
+    swap(ch, ch2);
+    BOOST_TEST(ch == nullptr);
+    BOOST_TEST(ch2.invoke() == 0xDEADBEEF);
+    BOOST_TEST(ch2 == nullptr);
+
+    ch = mf;
+    ch = nullptr;
+    BOOST_TEST(!ch);
+
+    BOOST_TEST(ctrl.allocatons_left == 0);
+    BOOST_TEST(ctrl.deallocations == 0);
+}
+
+} // namespace netu
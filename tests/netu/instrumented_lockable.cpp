@@ -0,0 +1,206 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/instrumented_lockable.hpp>
+#include <netu/synchronized_value.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+
+namespace netu
+{
+
+namespace
+{
+
+std::uint64_t
+total(lock_stats::histogram_type const& h)
+{
+    std::uint64_t n = 0;
+    for (auto c : h)
+    {
+        n += c;
+    }
+    return n;
+}
+
+bool
+is_registered(lock_stats const& s)
+{
+    bool found = false;
+    lock_registry::instance().for_each(
+      [&](lock_stats const& r) { found = found || &r == &s; });
+    return found;
+}
+
+lock_stats const*
+find(std::string const& name)
+{
+    lock_stats const* found = nullptr;
+    lock_registry::instance().for_each([&](lock_stats const& r) {
+        if (r.name() == name)
+        {
+            found = &r;
+        }
+    });
+    return found;
+}
+
+// Provides only lock() and unlock()
+class basic_lockable
+{
+public:
+    void lock()
+    {
+        m_.lock();
+    }
+
+    void unlock()
+    {
+        m_.unlock();
+    }
+
+private:
+    std::mutex m_;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(lock_stats_buckets)
+{
+    using ns = std::chrono::nanoseconds;
+    BOOST_TEST(lock_stats::bucket(ns{0}) == 0u);
+    BOOST_TEST(lock_stats::bucket(ns{1}) == 1u);
+    BOOST_TEST(lock_stats::bucket(ns{2}) == 2u);
+    BOOST_TEST(lock_stats::bucket(ns{3}) == 2u);
+    BOOST_TEST(lock_stats::bucket(ns{1024}) == 11u);
+    BOOST_TEST(lock_stats::bucket(std::chrono::hours{1}) ==
+               lock_stats::bucket_count - 1);
+
+    lock_stats::histogram_type h{};
+    h[3] = 99;
+    h[10] = 1;
+    BOOST_TEST(lock_stats::percentile(h, 50).count() == 8);
+    BOOST_TEST(lock_stats::percentile(h, 99).count() == 8);
+    BOOST_TEST(lock_stats::percentile(h, 100).count() == 1024);
+}
+
+BOOST_AUTO_TEST_CASE(instrumented_lockable_counts)
+{
+    instrumented_lockable<std::mutex> m{"counts"};
+    BOOST_TEST(m.stats().name() == "counts");
+    BOOST_TEST(is_registered(m.stats()));
+
+    m.lock();
+    BOOST_TEST(!m.try_lock());
+    m.unlock();
+    BOOST_TEST(m.try_lock());
+    m.unlock();
+
+    BOOST_TEST(m.stats().acquisitions() == 2u);
+    BOOST_TEST(m.stats().contentions() == 0u);
+    BOOST_TEST(total(m.stats().wait_histogram()) == 2u);
+    BOOST_TEST(total(m.stats().hold_histogram()) == 2u);
+}
+
+BOOST_AUTO_TEST_CASE(instrumented_lockable_contention)
+{
+    instrumented_lockable<std::mutex> m;
+
+    m.lock();
+    std::thread t{[&]() {
+        m.lock();
+        m.unlock();
+    }};
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    m.unlock();
+    t.join();
+
+    BOOST_TEST(m.stats().acquisitions() == 2u);
+    BOOST_TEST(m.stats().contentions() == 1u);
+    auto const wait = m.stats().wait_histogram();
+    BOOST_TEST(lock_stats::percentile(wait, 100).count() >= 1000000);
+}
+
+BOOST_AUTO_TEST_CASE(instrumented_basic_lockable)
+{
+    instrumented_lockable<basic_lockable> m{"basic"};
+    {
+        std::lock_guard<instrumented_lockable<basic_lockable>> guard{m};
+    }
+
+    BOOST_TEST(m.stats().acquisitions() == 1u);
+    BOOST_TEST(m.stats().contentions() == 0u);
+    BOOST_TEST(total(m.stats().hold_histogram()) == 1u);
+}
+
+BOOST_AUTO_TEST_CASE(instrumented_timed_lockable)
+{
+    synchronized_value<int, instrumented_lockable<std::timed_mutex>> sv{
+      std::piecewise_construct,
+      std::forward_as_tuple(42),
+      std::forward_as_tuple("timed")};
+    auto const& stats =
+      detail::synchronized_value_access::mutex(sv).stats();
+
+    auto const deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds{10};
+    auto r = netu::apply_until(deadline, [](int& v) { return v; }, sv);
+    BOOST_REQUIRE(r);
+    BOOST_TEST(*r == 42);
+    BOOST_TEST(stats.acquisitions() == 1u);
+
+    netu::apply(
+      [&](int&) {
+          std::thread t{[&]() {
+              auto const start = std::chrono::steady_clock::now();
+              auto const r = netu::apply_until(
+                start + std::chrono::milliseconds{10},
+                [](int& v) { return v; },
+                sv);
+              BOOST_TEST(!r);
+          }};
+          t.join();
+      },
+      sv);
+    BOOST_TEST(stats.acquisitions() == 2u);
+    BOOST_TEST(stats.contentions() == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(instrumented_lockable_registry)
+{
+    lock_stats const* stats = nullptr;
+    {
+        synchronized_value<int, instrumented_lockable<std::mutex>> sv{
+          std::piecewise_construct,
+          std::forward_as_tuple(42),
+          std::forward_as_tuple("registry")};
+        netu::apply([](int& i) { ++i; }, sv);
+        auto const& csv = sv;
+        BOOST_TEST(netu::apply([](int const& i) { return i; }, csv) == 43);
+
+        stats = find("registry");
+        BOOST_REQUIRE(stats != nullptr);
+        BOOST_TEST(stats->acquisitions() == 2u);
+
+        std::ostringstream os;
+        lock_registry::instance().dump(os);
+        BOOST_TEST(os.str().find("registry: acquisitions=2 contentions=0") !=
+                   std::string::npos);
+    }
+    BOOST_TEST(find("registry") == nullptr);
+}
+
+} // namespace netu
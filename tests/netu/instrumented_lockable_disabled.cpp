@@ -0,0 +1,55 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#define NETU_DISABLE_LOCK_INSTRUMENTATION
+
+#include <netu/instrumented_lockable.hpp>
+#include <netu/synchronized_value.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <mutex>
+#include <tuple>
+
+namespace netu
+{
+
+static_assert(!instrumented_lockable<std::mutex>::enabled, "");
+static_assert(sizeof(instrumented_lockable<std::mutex>) == sizeof(std::mutex),
+              "Disabled instrumentation must not add any state");
+static_assert(sizeof(instrumented_lockable<std::timed_mutex>) ==
+                sizeof(std::timed_mutex),
+              "Disabled instrumentation must not add any state");
+
+BOOST_AUTO_TEST_CASE(disabled_instrumentation)
+{
+    synchronized_value<int, instrumented_lockable<std::timed_mutex>> sv{
+      std::piecewise_construct,
+      std::forward_as_tuple(42),
+      std::forward_as_tuple("disabled")};
+
+    netu::apply([](int& v) { ++v; }, sv);
+    auto r = netu::apply_until(std::chrono::steady_clock::now() +
+                                 std::chrono::seconds{10},
+                               [](int& v) { return v; },
+                               sv);
+    BOOST_REQUIRE(r);
+    BOOST_TEST(*r == 43);
+
+    auto const& stats = detail::synchronized_value_access::mutex(sv).stats();
+    BOOST_TEST(stats.acquisitions() == 0u);
+
+    bool found = false;
+    lock_registry::instance().for_each(
+      [&](lock_stats const& s) { found = found || s.name() == "disabled"; });
+    BOOST_TEST(!found);
+}
+
+} // namespace netu
@@ -0,0 +1,205 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/rcu_value.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace netu
+{
+
+namespace
+{
+
+struct counted
+{
+    counted() noexcept
+    {
+        ++instances;
+    }
+
+    counted(counted const& other) noexcept
+      : value{other.value}
+    {
+        ++instances;
+    }
+
+    ~counted()
+    {
+        --instances;
+    }
+
+    int value = 0;
+
+    static int instances;
+};
+
+int counted::instances = 0;
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(rcu_apply)
+{
+    rcu_value<std::map<std::string, int>> rv{
+      std::map<std::string, int>{{"a", 1}}};
+    auto const& crv = rv;
+
+    auto v = netu::apply(
+      [](std::map<std::string, int> const& m) { return m.at("a"); }, crv);
+    BOOST_TEST(v == 1);
+
+    netu::apply([](std::map<std::string, int>& m) { m["b"] = 2; }, rv);
+
+    // A snapshot taken before an update is not affected by it
+    netu::apply(
+      [&](std::map<std::string, int> const& m) {
+          BOOST_TEST(m.size() == 2u);
+          netu::apply([](std::map<std::string, int>& m) { m.erase("a"); },
+                      rv);
+          BOOST_TEST(m.size() == 2u);
+      },
+      crv);
+
+    rcu_value<int> rv2{42};
+    auto const& crv2 = rv2;
+    auto sum = netu::apply(
+      [](std::map<std::string, int> const& m, int const& i) {
+          return m.at("b") + i;
+      },
+      crv,
+      crv2);
+    BOOST_TEST(sum == 44);
+}
+
+BOOST_AUTO_TEST_CASE(rcu_exception)
+{
+    rcu_value<int> rv{42};
+    auto const& crv = rv;
+
+    BOOST_CHECK_THROW(netu::apply(
+                        [](int& v) {
+                            v = 43;
+                            throw std::runtime_error{"test"};
+                        },
+                        rv),
+                      std::runtime_error);
+    BOOST_TEST(netu::apply([](int const& v) { return v; }, crv) == 42);
+}
+
+BOOST_AUTO_TEST_CASE(rcu_nesting_limit)
+{
+    rcu_value<int> rv{1};
+    auto const& crv = rv;
+
+    auto read = [&crv](int const& v1, int const& v2) {
+        return netu::apply(
+          [&](int const& v3, int const& v4) {
+              // All the snapshots of the thread are in use
+              return netu::apply([](int const& v) { return v; }, crv) +
+                     v1 + v2 + v3 + v4;
+          },
+          crv,
+          crv);
+    };
+    BOOST_CHECK_THROW(netu::apply(read, crv, crv), std::length_error);
+
+    // The snapshots have been released by the throwing apply() calls
+    BOOST_TEST(netu::apply(
+                 [&](int const& v1, int const& v2, int const& v3) {
+                     return netu::apply([](int const& v) { return v; }, crv) +
+                            v1 + v2 + v3;
+                 },
+                 crv,
+                 crv,
+                 crv) == 4);
+}
+
+BOOST_AUTO_TEST_CASE(rcu_reclamation)
+{
+    {
+        rcu_value<counted> rv;
+        auto const& crv = rv;
+        BOOST_TEST(counted::instances == 1);
+
+        netu::apply([](counted& c) { ++c.value; }, rv);
+        BOOST_TEST(counted::instances == 1);
+
+        netu::apply(
+          [&](counted const&) {
+              netu::apply([](counted& c) { ++c.value; }, rv);
+              // The snapshot in use can't be reclaimed yet
+              BOOST_TEST(counted::instances == 2);
+          },
+          crv);
+
+        netu::apply([](counted& c) { ++c.value; }, rv);
+        BOOST_TEST(counted::instances == 1);
+        BOOST_TEST(netu::apply([](counted const& c) { return c.value; },
+                               crv) == 3);
+    }
+    BOOST_TEST(counted::instances == 0);
+}
+
+BOOST_AUTO_TEST_CASE(rcu_concurrent)
+{
+    rcu_value<std::vector<int>> rv{std::vector<int>(16, 0)};
+    auto const& crv = rv;
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i)
+    {
+        readers.emplace_back([&]() {
+            while (!done.load())
+            {
+                netu::apply(
+                  [&](std::vector<int> const& v) {
+                      for (auto i : v)
+                      {
+                          if (i != v.front())
+                          {
+                              ++torn;
+                          }
+                      }
+                  },
+                  crv);
+            }
+        });
+    }
+
+    for (int i = 1; i <= 10000; ++i)
+    {
+        netu::apply(
+          [i](std::vector<int>& v) {
+              for (auto& e : v)
+              {
+                  e = i;
+              }
+          },
+          rv);
+    }
+
+    done = true;
+    for (auto& t : readers)
+    {
+        t.join();
+    }
+
+    BOOST_TEST(torn.load() == 0);
+}
+
+} // namespace netu
@@ -0,0 +1,120 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/seqlock.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace netu
+{
+
+namespace
+{
+
+struct pair_snapshot
+{
+    std::uint64_t first;
+    std::uint64_t second;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(seqlock_lockable)
+{
+    seqlock sl;
+    auto const seq = sl.read_begin();
+    BOOST_TEST(!sl.read_retry(seq));
+
+    BOOST_TEST(sl.try_lock());
+    BOOST_TEST(!sl.try_lock());
+    sl.unlock();
+
+    BOOST_TEST(sl.read_retry(seq));
+    BOOST_TEST(!sl.read_retry(sl.read_begin()));
+}
+
+BOOST_AUTO_TEST_CASE(seqlock_apply)
+{
+    synchronized_value<int, seqlock> sv1{42};
+    synchronized_value<pair_snapshot, seqlock> sv2{pair_snapshot{1, 2}};
+    auto const& csv1 = sv1;
+    auto const& csv2 = sv2;
+
+    auto v = apply([](int const& v) { return v; }, csv1);
+    BOOST_TEST(v == 42);
+
+    apply(
+      [](int& v1, pair_snapshot& v2) {
+          v1 = 43;
+          v2.second = 3;
+      },
+      sv1,
+      sv2);
+
+    auto sum = apply(
+      [](int const& v1, pair_snapshot const& v2) {
+          return v1 + v2.first + v2.second;
+      },
+      csv1,
+      csv2);
+    BOOST_TEST(sum == 43u + 1u + 3u);
+}
+
+BOOST_AUTO_TEST_CASE(seqlock_consistency)
+{
+    synchronized_value<pair_snapshot, seqlock> sv{pair_snapshot{0, 0}};
+    auto const& csv = sv;
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; ++i)
+    {
+        readers.emplace_back([&]() {
+            while (!done.load())
+            {
+                apply(
+                  [&](pair_snapshot const& p) {
+                      if (p.first != p.second)
+                      {
+                          ++torn;
+                      }
+                  },
+                  csv);
+            }
+        });
+    }
+
+    for (std::uint64_t i = 1; i <= 100000; ++i)
+    {
+        apply(
+          [i](pair_snapshot& p) {
+              p.first = i;
+              p.second = i;
+          },
+          sv);
+    }
+
+    done = true;
+    for (auto& t : readers)
+    {
+        t.join();
+    }
+
+    BOOST_TEST(torn.load() == 0);
+    BOOST_TEST(apply([](pair_snapshot const& p) { return p.first; }, csv) ==
+               100000u);
+}
+
+} // namespace netu
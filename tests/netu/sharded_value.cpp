@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/sharded_value.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace netu
+{
+
+BOOST_AUTO_TEST_CASE(sharded_apply)
+{
+    sharded_value<int, 4> sv;
+    auto const& csv = sv;
+
+    static_assert(alignof(decltype(sv)) >= 64, "Shards must be padded");
+    BOOST_TEST(&sv.local_shard() == &sv.local_shard());
+
+    netu::apply([](int& v) { v += 2; }, sv);
+    netu::apply([](int& v) { v += 3; }, sv.shard(3));
+    BOOST_TEST(sv.combine(0, [](int acc, int v) { return acc + v; }) == 5);
+
+    auto sum = netu::apply(
+      [](int const& v0, int const& v1, int const& v2, int const& v3) {
+          return v0 + v1 + v2 + v3;
+      },
+      csv);
+    BOOST_TEST(sum == 5);
+}
+
+BOOST_AUTO_TEST_CASE(sharded_concurrent)
+{
+    sharded_value<std::uint64_t, 8> sv;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i)
+    {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < 10000; ++j)
+            {
+                netu::apply([](std::uint64_t& v) { ++v; }, sv);
+            }
+        });
+    }
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    BOOST_TEST(sv.combine(std::uint64_t{0},
+                          [](std::uint64_t acc, std::uint64_t v) {
+                              return acc + v;
+                          }) == 80000u);
+}
+
+} // namespace netu
@@ -0,0 +1,83 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/netutils
+//
+
+#include <netu/synchronized_array.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+
+namespace netu
+{
+
+namespace
+{
+
+template<typename T>
+std::uintptr_t
+cache_line_of(T const& t)
+{
+    return reinterpret_cast<std::uintptr_t>(&t) / cache_line_size;
+}
+
+} // namespace
+
+static_assert(sizeof(synchronized_value<char, std::mutex>) <
+                cache_line_size,
+              "The default layout must not add padding");
+static_assert(alignof(synchronized_value<char, std::mutex, colocated_layout>) ==
+                cache_line_size,
+              "");
+static_assert(sizeof(synchronized_value<char, std::mutex, colocated_layout>) ==
+                cache_line_size,
+              "Tiny values must share a cache line with the mutex");
+static_assert(sizeof(synchronized_value<char, std::mutex, padded_layout>) ==
+                2 * cache_line_size,
+              "Value and mutex must be on separate cache lines");
+
+BOOST_AUTO_TEST_CASE(array_layout)
+{
+    synchronized_array<int, 4> arr;
+    BOOST_TEST(arr.size() == 4u);
+
+    for (std::size_t i = 1; i < arr.size(); ++i)
+    {
+        BOOST_TEST(cache_line_of(arr[i]) != cache_line_of(arr[i - 1]));
+    }
+
+    synchronized_array<int, 2, std::mutex, padded_layout> padded;
+    netu::apply(
+      [&](int& v) {
+          BOOST_TEST(cache_line_of(v) != cache_line_of(padded[1]));
+      },
+      padded[0]);
+}
+
+BOOST_AUTO_TEST_CASE(array_apply)
+{
+    synchronized_array<int, 4> arr;
+
+    // Elements are value-initialized
+    for (auto const& sv : arr)
+    {
+        BOOST_TEST(netu::apply([](int const& v) { return v; }, sv) == 0);
+    }
+
+    netu::apply([](int& v1, int& v2) { v1 = v2 = 42; }, arr[0], arr[3]);
+
+    auto const& carr = arr;
+    auto sum = netu::apply(
+      [](int const& v0, int const& v1, int const& v3) { return v0 + v1 + v3; },
+      carr[0],
+      carr[1],
+      carr[3]);
+    BOOST_TEST(sum == 84);
+}
+
+} // namespace netu
@@ -11,14 +11,51 @@
 
 #include <boost/asio/local/connect_pair.hpp>
 #include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
 #include <boost/mpl/list.hpp>
 #include <boost/test/unit_test.hpp>
+#include <netu/test/allocator.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace netu
 {
 
 using test_stream_t = boost::asio::local::stream_protocol::socket;
 
+using duplex_stream_t =
+  synchronized_stream<test_stream_t,
+                      boost::asio::strand<test_stream_t::executor_type>,
+                      boost::asio::strand<test_stream_t::executor_type>>;
+
+// Counts the write_some operations initiated on the socket
+class counting_stream : public test_stream_t
+{
+public:
+    using test_stream_t::test_stream_t;
+
+    template<typename ConstBuffers, typename WriteHandler>
+    auto async_write_some(ConstBuffers const& b, WriteHandler&& h)
+      -> decltype(std::declval<test_stream_t&>().async_write_some(
+        b,
+        std::forward<WriteHandler>(h)))
+    {
+        ++write_count_;
+        return test_stream_t::async_write_some(b,
+                                               std::forward<WriteHandler>(h));
+    }
+
+    std::size_t write_count_ = 0;
+};
+
 struct synchronized_stream_ctx_fixture
 {
     synchronized_stream_ctx_fixture()
@@ -100,4 +137,561 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(read, Fixture, fixture_list_t)
     BOOST_TEST(rb == "test");
 }
 
+BOOST_AUTO_TEST_CASE(coalesced_write)
+{
+    boost::asio::io_context ctx;
+    synchronized_stream<counting_stream> stream1{ctx};
+    synchronized_stream<test_stream_t> stream2{ctx};
+    boost::asio::local::connect_pair(stream1.lowest_layer(),
+                                     stream2.lowest_layer());
+
+    std::string const str{"0123456789"};
+    std::vector<std::size_t> completed;
+    for (std::size_t i = 0; i < 100; ++i)
+    {
+        stream1.async_write(
+          boost::asio::buffer(&str[i % str.size()], 1),
+          [&completed, i](boost::system::error_code ec, std::size_t n) {
+              BOOST_TEST(!ec);
+              BOOST_TEST(n == 1u);
+              completed.push_back(i);
+          });
+    }
+    stream1.async_write(boost::asio::const_buffer{},
+                        [&completed](boost::system::error_code ec,
+                                     std::size_t n) {
+                            BOOST_TEST(!ec);
+                            BOOST_TEST(n == 0u);
+                            completed.push_back(100);
+                        });
+
+    std::string rb(100, '\0');
+    boost::asio::async_read(stream2,
+                            boost::asio::buffer(rb),
+                            [](boost::system::error_code ec, std::size_t n) {
+                                BOOST_TEST(!ec);
+                                BOOST_TEST(n == 100u);
+                            });
+    ctx.run();
+
+    // 64 single buffer writes fit into one write_some
+    BOOST_TEST(stream1.next_layer().write_count_ == 2u);
+    BOOST_TEST(completed.size() == 101u);
+    BOOST_TEST(std::is_sorted(completed.begin(), completed.end()));
+    for (std::size_t i = 0; i < rb.size(); ++i)
+    {
+        BOOST_TEST(rb[i] == str[i % str.size()]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_write)
+{
+    boost::asio::io_context ctx;
+    synchronized_stream<test_stream_t> stream1{ctx};
+    synchronized_stream<test_stream_t> stream2{ctx};
+    boost::asio::local::connect_pair(stream1.lowest_layer(),
+                                     stream2.lowest_layer());
+
+    constexpr std::size_t producers = 4;
+    constexpr std::size_t writes = 250;
+    std::string const str{"abcde"};
+    std::atomic<std::size_t> completed{0};
+
+    std::string rb(producers * writes * 2, '\0');
+    boost::asio::async_read(stream2,
+                            boost::asio::buffer(rb),
+                            [](boost::system::error_code ec, std::size_t) {
+                                BOOST_TEST(!ec);
+                            });
+
+    std::vector<std::thread> threads;
+    for (std::size_t p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]() {
+            for (std::size_t i = 0; i < writes; ++i)
+            {
+                stream1.async_write(
+                  boost::asio::buffer(&str[p], 2),
+                  [&completed](boost::system::error_code ec, std::size_t n) {
+                      BOOST_TEST(!ec);
+                      BOOST_TEST(n == 2u);
+                      ++completed;
+                  });
+            }
+        });
+    }
+    ctx.run();
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    BOOST_TEST(completed == producers * writes);
+    for (std::size_t i = 0; i < rb.size(); i += 2)
+    {
+        BOOST_TEST(rb[i] + 1 == rb[i + 1]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(failed_write)
+{
+    boost::asio::io_context ctx;
+    synchronized_stream<test_stream_t> stream{ctx};
+
+    std::string const str{"test"};
+    std::size_t failed = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        stream.async_write(
+          boost::asio::buffer(str),
+          [&failed](boost::system::error_code ec, std::size_t n) {
+              BOOST_TEST(ec);
+              BOOST_TEST(n == 0u);
+              ++failed;
+          });
+    }
+    ctx.run();
+
+    BOOST_TEST(failed == 2u);
+}
+
+BOOST_AUTO_TEST_CASE(throwing_write_handler)
+{
+    boost::asio::io_context ctx;
+    synchronized_stream<test_stream_t> stream1{ctx};
+    synchronized_stream<test_stream_t> stream2{ctx};
+    boost::asio::local::connect_pair(stream1.lowest_layer(),
+                                     stream2.lowest_layer());
+
+    // More writes than fit into a single write_some, so that the flush is
+    // still in progress when the first handler throws
+    constexpr std::size_t writes = 100;
+    std::string const str{"0123456789"};
+    std::vector<std::size_t> completed;
+    auto const write = [&](std::size_t i) {
+        stream1.async_write(
+          boost::asio::buffer(&str[i % str.size()], 1),
+          [&completed, i](boost::system::error_code ec, std::size_t n) {
+              BOOST_TEST(!ec);
+              BOOST_TEST(n == 1u);
+              completed.push_back(i);
+              if (i == 0)
+              {
+                  throw std::runtime_error{"handler"};
+              }
+          });
+    };
+    for (std::size_t i = 0; i < writes; ++i)
+    {
+        write(i);
+    }
+
+    std::string rb(writes + 1, '\0');
+    auto const read = [&](std::size_t offset, std::size_t size) {
+        boost::asio::async_read(
+          stream2,
+          boost::asio::buffer(&rb[offset], size),
+          [size](boost::system::error_code ec, std::size_t n) {
+              BOOST_TEST(!ec);
+              BOOST_TEST(n == size);
+          });
+    };
+    read(0, writes);
+
+    BOOST_CHECK_THROW(ctx.run(), std::runtime_error);
+    ctx.restart();
+    ctx.run();
+    BOOST_TEST(completed.size() == writes);
+
+    // The queue keeps flushing after the exception
+    write(writes);
+    read(writes, 1);
+    ctx.restart();
+    ctx.run();
+
+    BOOST_TEST(completed.size() == writes + 1);
+    BOOST_TEST(std::is_sorted(completed.begin(), completed.end()));
+    for (std::size_t i = 0; i < rb.size(); ++i)
+    {
+        BOOST_TEST(rb[i] == str[i % str.size()]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ordered_write_completions)
+{
+    // Writes complete in order even if the write executor isn't a strand
+    using ctx_executor_t = boost::asio::io_context::executor_type;
+    using socket_t =
+      boost::asio::basic_stream_socket<boost::asio::local::stream_protocol,
+                                       ctx_executor_t>;
+    using stream_t = synchronized_stream<socket_t,
+                                         boost::asio::strand<ctx_executor_t>,
+                                         ctx_executor_t>;
+
+    boost::asio::io_context ctx;
+    stream_t stream1{ctx};
+    stream_t stream2{ctx};
+    boost::asio::local::connect_pair(stream1.lowest_layer(),
+                                     stream2.lowest_layer());
+
+    constexpr std::size_t writes = 1000;
+    std::string const str{"0123456789"};
+    std::mutex mutex;
+    std::vector<std::size_t> completed;
+    for (std::size_t i = 0; i < writes; ++i)
+    {
+        stream1.async_write(
+          boost::asio::buffer(&str[i % str.size()], 1),
+          [&mutex, &completed, i](boost::system::error_code ec, std::size_t) {
+              BOOST_REQUIRE(!ec);
+              {
+                  std::lock_guard<std::mutex> guard{mutex};
+                  completed.push_back(i);
+              }
+
+              // Gives the next write time to complete on another thread
+              if (i == 0)
+              {
+                  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+              }
+          });
+    }
+
+    std::string rb(writes, '\0');
+    boost::asio::async_read(stream2,
+                            boost::asio::buffer(rb),
+                            [](boost::system::error_code ec, std::size_t n) {
+                                BOOST_REQUIRE(!ec);
+                                BOOST_REQUIRE(n == writes);
+                            });
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&ctx]() { ctx.run(); });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    BOOST_TEST(completed.size() == writes);
+    BOOST_TEST(std::is_sorted(completed.begin(), completed.end()));
+}
+
+BOOST_AUTO_TEST_CASE(split_executors)
+{
+    boost::asio::io_context ctx;
+    synchronized_stream<test_stream_t> stream{ctx};
+    duplex_stream_t duplex{ctx};
+
+    BOOST_TEST((stream.get_executor() == stream.get_write_executor()));
+    BOOST_TEST((duplex.get_executor() != duplex.get_write_executor()));
+
+    duplex_stream_t explicit_duplex{
+      ctx, stream.get_executor(), duplex.get_write_executor()};
+    BOOST_TEST(
+      (explicit_duplex.get_write_executor() == duplex.get_write_executor()));
+}
+
+BOOST_AUTO_TEST_CASE(full_duplex)
+{
+    boost::asio::io_context ctx;
+    duplex_stream_t stream1{ctx};
+    duplex_stream_t stream2{ctx};
+    boost::asio::local::connect_pair(stream1.lowest_layer(),
+                                     stream2.lowest_layer());
+
+    std::string const str{"test"};
+    std::string rb = "1234";
+    std::atomic<bool> written{false};
+    bool overlapped = false;
+
+    // The read handler of stream1 waits for its write handler, which can only
+    // finish first if they are not serialized against each other.
+    stream1.async_read_some(
+      boost::asio::buffer(rb),
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          BOOST_TEST(n == 4u);
+          BOOST_TEST(stream1.get_executor().running_in_this_thread());
+          BOOST_TEST(!stream1.get_write_executor().running_in_this_thread());
+
+          auto const deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds{10};
+          while (!written && std::chrono::steady_clock::now() < deadline)
+          {
+              std::this_thread::yield();
+          }
+          overlapped = written;
+
+          stream1.async_write(boost::asio::buffer(str),
+                              [](boost::system::error_code, std::size_t) {});
+      });
+    stream2.async_write(boost::asio::buffer(str),
+                        [&](boost::system::error_code ec, std::size_t) {
+                            BOOST_TEST(!ec);
+                            stream1.async_write_some(
+                              boost::asio::buffer(str),
+                              [&](boost::system::error_code ec, std::size_t) {
+                                  BOOST_TEST(!ec);
+                                  BOOST_TEST(stream1.get_write_executor()
+                                               .running_in_this_thread());
+                                  written = true;
+                              });
+                        });
+
+    std::string rb2(8, '\0');
+    boost::asio::async_read(stream2,
+                            boost::asio::buffer(rb2),
+                            [](boost::system::error_code ec, std::size_t) {
+                                BOOST_TEST(!ec);
+                            });
+
+    std::thread t{[&ctx]() { ctx.run(); }};
+    ctx.run();
+    t.join();
+
+    BOOST_TEST(overlapped);
+    BOOST_TEST(rb == "test");
+    BOOST_TEST(rb2 == "testtest");
+}
+
+BOOST_AUTO_TEST_CASE(recycling_slot)
+{
+    using detail::allocators::recycling_slot;
+    using detail::allocators::slot_allocator;
+
+    auto slot = recycling_slot::create();
+    slot_allocator<std::array<char, 64>> alloc{*slot};
+    slot_allocator<std::array<char, 32>> small_alloc{alloc};
+    BOOST_TEST((alloc == small_alloc));
+
+    auto p1 = alloc.allocate(1);
+    alloc.deallocate(p1, 1);
+    BOOST_TEST(alloc.allocate(1) == p1);
+
+    auto p2 = small_alloc.allocate(1);
+    small_alloc.deallocate(p2, 1);
+    BOOST_TEST(small_alloc.allocate(1) == p2);
+
+    // Both blocks are in use, so this one comes from the heap
+    auto p3 = small_alloc.allocate(1);
+    BOOST_TEST(static_cast<void*>(p3) != static_cast<void*>(p1));
+    BOOST_TEST(p3 != p2);
+    small_alloc.deallocate(p3, 1);
+    small_alloc.deallocate(p2, 1);
+
+    // Memory allocated from a released slot stays valid until returned
+    slot.reset();
+    p1->fill('x');
+    alloc.deallocate(p1, 1);
+}
+
+namespace
+{
+
+struct allocating_handler
+{
+    using allocator_type = test::allocator<allocating_handler>;
+
+    allocator_type get_allocator() const noexcept
+    {
+        return alloc_;
+    }
+
+    void operator()(boost::system::error_code ec, std::size_t n)
+    {
+        BOOST_TEST(!ec);
+        BOOST_TEST(n == 4u);
+    }
+
+    allocator_type alloc_;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(custom_allocator_io)
+{
+    boost::asio::io_context ctx;
+    synchronized_stream<test_stream_t> stream1{ctx};
+    synchronized_stream<test_stream_t> stream2{ctx};
+    boost::asio::local::connect_pair(stream1.lowest_layer(),
+                                     stream2.lowest_layer());
+
+    test::allocator_control ctrl{};
+    ctrl.allocatons_left = 100;
+    std::string const str{"test"};
+    std::string rb = "1234";
+    stream1.async_write_some(boost::asio::buffer(str),
+                             allocating_handler{test::allocator<
+                               allocating_handler>{ctrl}});
+    stream2.async_read_some(boost::asio::buffer(rb),
+                            allocating_handler{test::allocator<
+                              allocating_handler>{ctrl}});
+    ctx.run();
+
+    // Handlers with a custom allocator don't use the recycled memory
+    BOOST_TEST(ctrl.allocatons_left < 100u);
+    BOOST_TEST(ctrl.deallocations == 100u - ctrl.allocatons_left);
+    BOOST_TEST(rb == "test");
+}
+
+BOOST_AUTO_TEST_CASE(operation_outlives_stream)
+{
+    std::string rb = "1234";
+    bool invoked = false;
+    {
+        boost::asio::io_context ctx;
+        {
+            synchronized_stream<test_stream_t> stream1{ctx};
+            synchronized_stream<test_stream_t> stream2{ctx};
+            boost::asio::local::connect_pair(stream1.lowest_layer(),
+                                             stream2.lowest_layer());
+            stream2.async_read_some(
+              boost::asio::buffer(rb),
+              [&invoked](boost::system::error_code, std::size_t) {
+                  invoked = true;
+              });
+        }
+        // The aborted read is destroyed together with ctx, after its memory
+        // slot has been released by the stream.
+    }
+    BOOST_TEST(!invoked);
+}
+
+BOOST_AUTO_TEST_CASE(speculative_io)
+{
+    boost::asio::io_context ctx;
+    synchronized_stream<counting_stream> stream1{ctx};
+    synchronized_stream<test_stream_t> stream2{ctx};
+    boost::asio::local::connect_pair(stream1.lowest_layer(),
+                                     stream2.lowest_layer());
+    BOOST_TEST(!stream1.speculative_io());
+    stream1.set_speculative_io(true);
+    stream2.set_speculative_io(true);
+    BOOST_TEST(stream1.speculative_io());
+    BOOST_TEST(stream1.lowest_layer().non_blocking());
+
+    // Nothing to read yet, so the read waits in the reactor
+    std::string rb = "1234";
+    std::size_t reads = 0;
+    auto on_read = [&](boost::system::error_code ec, std::size_t n) {
+        BOOST_TEST(stream2.get_executor().running_in_this_thread());
+        BOOST_TEST(!ec);
+        BOOST_TEST(n == 4u);
+        ++reads;
+    };
+    stream2.async_read_some(boost::asio::buffer(rb), on_read);
+
+    // The socket is writable, so the write doesn't go through the reactor,
+    // but its handler is still not invoked inline.
+    std::string const str{"test"};
+    std::size_t writes = 0;
+    auto on_write = [&](boost::system::error_code ec, std::size_t n) {
+        BOOST_TEST(stream1.get_executor().running_in_this_thread());
+        BOOST_TEST(!ec);
+        BOOST_TEST(n == 4u);
+        ++writes;
+    };
+    stream1.async_write_some(boost::asio::buffer(str), on_write);
+    BOOST_TEST(writes == 0u);
+    BOOST_TEST(stream1.next_layer().write_count_ == 0u);
+
+    ctx.run();
+    BOOST_TEST(writes == 1u);
+    BOOST_TEST(reads == 1u);
+    BOOST_TEST(rb == "test");
+
+    // Data is already available, so the read completes speculatively
+    rb = "1234";
+    stream1.async_write_some(boost::asio::buffer(str), on_write);
+    ctx.restart();
+    ctx.run();
+    stream2.async_read_some(boost::asio::buffer(rb), on_read);
+    BOOST_TEST(reads == 1u);
+    ctx.restart();
+    ctx.run();
+    BOOST_TEST(reads == 2u);
+    BOOST_TEST(rb == "test");
+
+    // Errors other than would_block complete speculatively as well
+    stream1.lowest_layer().close();
+    stream2.async_read_some(
+      boost::asio::buffer(rb),
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(ec == boost::asio::error::eof);
+          BOOST_TEST(n == 0u);
+          ++reads;
+      });
+    ctx.restart();
+    ctx.run();
+    BOOST_TEST(reads == 3u);
+
+    stream2.set_speculative_io(false);
+    BOOST_TEST(!stream2.speculative_io());
+    BOOST_TEST(!stream2.lowest_layer().non_blocking());
+}
+
+BOOST_AUTO_TEST_CASE(sync_io)
+{
+    boost::asio::io_context ctx;
+    synchronized_stream<test_stream_t> stream1{ctx};
+    synchronized_stream<test_stream_t> stream2{ctx};
+    boost::asio::local::connect_pair(stream1.lowest_layer(),
+                                     stream2.lowest_layer());
+
+    std::string const str{"test"};
+    std::string rb = "1234";
+    BOOST_TEST(stream1.write_some(boost::asio::buffer(str)) == 4u);
+    boost::system::error_code ec;
+    BOOST_TEST(stream2.read_some(boost::asio::buffer(rb), ec) == 4u);
+    BOOST_TEST(!ec);
+    BOOST_TEST(rb == "test");
+
+    BOOST_TEST(!stream2.non_blocking());
+    stream2.non_blocking(true);
+    BOOST_TEST(stream2.non_blocking());
+    BOOST_TEST(stream2.read_some(boost::asio::buffer(rb), ec) == 0u);
+    BOOST_TEST(ec == boost::asio::error::would_block);
+    BOOST_CHECK_THROW(stream2.read_some(boost::asio::buffer(rb)),
+                      boost::system::system_error);
+
+    // Disabling speculative I/O leaves the requested non-blocking mode intact
+    stream2.set_speculative_io(true);
+    stream2.set_speculative_io(false);
+    BOOST_TEST(stream2.non_blocking());
+
+    // Speculative I/O doesn't work in blocking mode
+    stream2.set_speculative_io(true);
+    stream2.non_blocking(false);
+    BOOST_TEST(!stream2.non_blocking());
+    BOOST_TEST(!stream2.speculative_io());
+
+    // Drain with synchronous reads, then wait for more data asynchronously
+    stream2.set_speculative_io(true);
+    BOOST_TEST(stream2.non_blocking());
+    stream1.write_some(boost::asio::buffer(str));
+    rb = "1234";
+    BOOST_TEST(stream2.read_some(boost::asio::buffer(rb), ec) == 4u);
+    BOOST_TEST(!ec);
+    BOOST_TEST(rb == "test");
+    stream2.read_some(boost::asio::buffer(rb), ec);
+    BOOST_TEST(ec == boost::asio::error::would_block);
+    rb = "1234";
+    stream2.async_read_some(
+      boost::asio::buffer(rb),
+      [](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          BOOST_TEST(n == 4u);
+      });
+    stream1.write_some(boost::asio::buffer(str));
+    ctx.run();
+    BOOST_TEST(rb == "test");
+
+    stream1.lowest_layer().close();
+    BOOST_TEST(stream2.read_some(boost::asio::buffer(rb), ec) == 0u);
+    BOOST_TEST(ec == boost::asio::error::eof);
+}
+
 } // namespace netu
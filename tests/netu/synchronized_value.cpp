@@ -12,7 +12,18 @@
 #include <boost/noncopyable.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
 #include <unordered_set>
+#include <vector>
+
+#if __cplusplus >= 201703L
+#include <shared_mutex>
+#endif
 
 namespace netu
 {
@@ -21,6 +32,8 @@ namespace
 {
 
 std::unordered_set<void*> lock_set;
+std::unordered_multiset<void*> shared_lock_set;
+std::vector<void*> lock_order;
 
 struct fake_basic_lockable : boost::noncopyable
 {
@@ -70,6 +83,58 @@ struct fake_lockable : boost::noncopyable
     }
 };
 
+struct ordered_lockable : fake_lockable
+{
+    void lock()
+    {
+        lock_order.push_back(this);
+        fake_lockable::lock();
+    }
+};
+
+struct fake_shared_lockable : fake_lockable
+{
+    void lock_shared()
+    {
+        BOOST_ASSERT(lock_set.count(this) == 0);
+        shared_lock_set.insert(this);
+    }
+
+    bool try_lock_shared()
+    {
+        lock_shared();
+        return true;
+    }
+
+    void unlock_shared() noexcept
+    {
+        auto it = shared_lock_set.find(this);
+        BOOST_ASSERT(it != shared_lock_set.end());
+        shared_lock_set.erase(it);
+    }
+};
+
+struct timed_lockable : fake_lockable
+{
+    bool try_lock()
+    {
+        if (busy)
+        {
+            return false;
+        }
+        lock();
+        return true;
+    }
+
+    template<typename Clock, typename Duration>
+    bool try_lock_until(std::chrono::time_point<Clock, Duration> const&)
+    {
+        return try_lock();
+    }
+
+    bool busy = false;
+};
+
 } // namespace
 
 BOOST_AUTO_TEST_CASE(single_value_apply)
@@ -123,4 +188,223 @@ BOOST_AUTO_TEST_CASE(multi_value_apply)
     BOOST_TEST(v == 43 * 2);
 }
 
+BOOST_AUTO_TEST_CASE(shared_apply)
+{
+    synchronized_value<int, fake_shared_lockable> sv1{42};
+    synchronized_value<int, fake_lockable> sv2{43};
+    auto const& csv1 = sv1;
+    auto const& csv2 = sv2;
+
+    auto v = apply(
+      [](int const& v) {
+          BOOST_TEST(lock_set.empty());
+          BOOST_TEST(shared_lock_set.size() == 1);
+          return v;
+      },
+      csv1);
+    BOOST_TEST(v == 42);
+    BOOST_TEST(shared_lock_set.empty());
+
+    v = apply(
+      [](int& v) {
+          BOOST_TEST(lock_set.size() == 1);
+          BOOST_TEST(shared_lock_set.empty());
+          return v;
+      },
+      sv1);
+    BOOST_TEST(v == 42);
+
+    v = apply(
+      [](int const& v1, int const& v2) {
+          BOOST_TEST(lock_set.size() == 1);
+          BOOST_TEST(shared_lock_set.size() == 1);
+          return v1 + v2;
+      },
+      csv1,
+      csv2);
+    BOOST_TEST(v == 42 + 43);
+    BOOST_TEST(lock_set.empty());
+    BOOST_TEST(shared_lock_set.empty());
+}
+
+#if __cplusplus >= 201703L
+BOOST_AUTO_TEST_CASE(concurrent_readers)
+{
+    synchronized_value<int, std::shared_mutex> sv{42};
+    std::atomic<int> readers{0};
+
+    // Both readers must be inside apply at the same time
+    auto read = [&]() {
+        return netu::apply(
+          [&](int const& v) {
+              ++readers;
+              auto const deadline =
+                std::chrono::steady_clock::now() + std::chrono::seconds{10};
+              while (readers.load() < 2 &&
+                     std::chrono::steady_clock::now() < deadline)
+              {
+                  std::this_thread::yield();
+              }
+              return readers.load() == 2 ? v : 0;
+          },
+          static_cast<decltype(sv) const&>(sv));
+    };
+
+    int other = 0;
+    std::thread t{[&]() { other = read(); }};
+    auto v = read();
+    t.join();
+
+    BOOST_TEST(v == 42);
+    BOOST_TEST(other == 42);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(ordered_apply)
+{
+    synchronized_value<int, ordered_lockable> svs[3];
+    lock_order.clear();
+
+    apply(
+      ordered_lock_policy{},
+      [](int& v0, int& v1, int& v2) {
+          BOOST_TEST(lock_set.size() == 3);
+          v0 = v1 = v2 = 0;
+      },
+      svs[2],
+      svs[0],
+      svs[1]);
+    BOOST_TEST(lock_set.empty());
+    BOOST_TEST(lock_order.size() == 3);
+    BOOST_TEST(std::is_sorted(lock_order.begin(), lock_order.end()));
+
+    synchronized_value<int, fake_shared_lockable> shared{42};
+    auto v = apply(
+      ordered_lock_policy{},
+      [](int const& v0, int const& v1) {
+          BOOST_TEST(lock_set.size() == 1);
+          BOOST_TEST(shared_lock_set.size() == 1);
+          return v0 + v1;
+      },
+      static_cast<decltype(svs[0]) const&>(svs[0]),
+      static_cast<decltype(shared) const&>(shared));
+    BOOST_TEST(v == 42);
+    BOOST_TEST(lock_set.empty());
+    BOOST_TEST(shared_lock_set.empty());
+
+    v = apply(
+      std_lock_policy{},
+      [](int& v0, int& v1) { return v0 + v1; },
+      svs[0],
+      shared);
+    BOOST_TEST(v == 42);
+}
+
+BOOST_AUTO_TEST_CASE(ordered_apply_deadlock_free)
+{
+    synchronized_value<int> sv1{0};
+    synchronized_value<int> sv2{0};
+
+    auto transfer = [](int& from, int& to) {
+        --from;
+        ++to;
+    };
+
+    std::thread t{[&]() {
+        for (int i = 0; i < 10000; ++i)
+        {
+            netu::apply(ordered_lock_policy{}, transfer, sv1, sv2);
+        }
+    }};
+    for (int i = 0; i < 10000; ++i)
+    {
+        netu::apply(ordered_lock_policy{}, transfer, sv2, sv1);
+    }
+    t.join();
+
+    BOOST_TEST(netu::apply([](int& v) { return v; }, sv1) == 0);
+    BOOST_TEST(netu::apply([](int& v) { return v; }, sv2) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(try_apply_all_or_nothing)
+{
+    synchronized_value<int, timed_lockable> sv1{1};
+    synchronized_value<int, timed_lockable> sv2{2};
+    auto sum = [](int& v1, int& v2) {
+        BOOST_TEST(lock_set.size() == 2);
+        return v1 + v2;
+    };
+
+    auto r = try_apply(sum, sv1, sv2);
+    BOOST_REQUIRE(r);
+    BOOST_TEST(*r == 3);
+    BOOST_TEST(lock_set.empty());
+
+    detail::synchronized_value_access::mutex(sv2).busy = true;
+    r = try_apply(sum, sv1, sv2);
+    BOOST_TEST(!r);
+    BOOST_TEST(lock_set.empty());
+
+    BOOST_TEST(!try_apply([](int&) {}, sv2));
+    BOOST_TEST(try_apply([](int&) {}, sv1));
+
+    auto const deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds{1};
+    BOOST_TEST(!apply_until(deadline, sum, sv1, sv2));
+    BOOST_TEST(lock_set.empty());
+
+    detail::synchronized_value_access::mutex(sv2).busy = false;
+    r = apply_until(deadline, sum, sv1, sv2);
+    BOOST_REQUIRE(r);
+    BOOST_TEST(*r == 3);
+    BOOST_TEST(lock_set.empty());
+
+    synchronized_value<int, fake_shared_lockable> shared{42};
+    auto v = try_apply(
+      [](int const& v) {
+          BOOST_TEST(shared_lock_set.size() == 1);
+          return v;
+      },
+      static_cast<decltype(shared) const&>(shared));
+    BOOST_REQUIRE(v);
+    BOOST_TEST(*v == 42);
+    BOOST_TEST(shared_lock_set.empty());
+}
+
+BOOST_AUTO_TEST_CASE(apply_until_timeout)
+{
+    synchronized_value<int, std::timed_mutex> sv{42};
+    std::promise<void> started;
+    std::promise<void> release;
+    auto released = release.get_future();
+
+    std::thread t{[&]() {
+        netu::apply(
+          [&](int&) {
+              started.set_value();
+              released.wait();
+          },
+          sv);
+    }};
+
+    started.get_future().wait();
+    auto const start = std::chrono::steady_clock::now();
+    auto r = netu::apply_until(start + std::chrono::milliseconds{10},
+                               [](int& v) { return v; },
+                               sv);
+    BOOST_TEST(!r);
+    BOOST_TEST((std::chrono::steady_clock::now() - start >=
+                std::chrono::milliseconds{10}));
+
+    release.set_value();
+    t.join();
+
+    r = netu::apply_until(std::chrono::steady_clock::now() +
+                            std::chrono::seconds{10},
+                          [](int& v) { return v; },
+                          sv);
+    BOOST_REQUIRE(r);
+    BOOST_TEST(*r == 42);
+}
+
 } // namespace netu